@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "device.hpp"
+#include "draw_queue.hpp"
+#include "frame_arena.hpp"
+#include "headless_context.hpp"
+#include "instance.hpp"
+#include "texture_streamer.hpp"
+
+// every allocation in the process goes through here, so the counts include the standard library's own.
+// the per thread count leaves out threads an engine call hands work to, like the streamer's loaders
+static std::atomic<size_t> allocation_count{ 0 };
+static thread_local size_t thread_allocation_count = 0;
+
+void* operator new(std::size_t size) {
+    ++allocation_count;
+    ++thread_allocation_count;
+
+    if (void* pointer = std::malloc(size != 0 ? size : 1)) {
+        return pointer;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned overloads, the original pointer is kept just before the aligned one
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    ++allocation_count;
+    ++thread_allocation_count;
+
+    std::size_t alignment_bytes = static_cast<std::size_t>(alignment);
+
+    if (void* pointer = std::malloc(size + alignment_bytes + sizeof(void*))) {
+        std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(pointer) + sizeof(void*) + alignment_bytes - 1) / alignment_bytes * alignment_bytes;
+        reinterpret_cast<void**>(aligned)[-1] = pointer;
+
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    if (pointer != nullptr) {
+        std::free(static_cast<void**>(pointer)[-1]);
+    }
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
+}
+
+namespace {
+    // runs one job per worker each frame, the threads themselves are created once up front
+    class worker_pool {
+    public:
+        worker_pool(unsigned thread_count, std::function<void(unsigned)> job) : job(std::move(job)), generation(0), remaining(0), stopping(false) {
+            for (unsigned i = 0; i < thread_count; ++i) {
+                threads.emplace_back([this, i] { run(i); });
+            }
+        }
+
+        ~worker_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            start_condition.notify_all();
+
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        }
+
+        void run_frame() {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            remaining = static_cast<unsigned>(threads.size());
+            ++generation;
+            start_condition.notify_all();
+
+            done_condition.wait(lock, [this] { return remaining == 0; });
+        }
+    private:
+        void run(unsigned thread_index) {
+            uint64_t seen_generation = 0;
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    start_condition.wait(lock, [&] { return stopping || generation != seen_generation; });
+
+                    if (stopping) {
+                        return;
+                    }
+
+                    seen_generation = generation;
+                }
+
+                job(thread_index);
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (--remaining == 0) {
+                    done_condition.notify_one();
+                }
+            }
+        }
+
+        std::function<void(unsigned)> job;
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable start_condition;
+        std::condition_variable done_condition;
+        uint64_t generation;
+        unsigned remaining;
+        bool stopping;
+    };
+
+    uint32_t hash(uint32_t value) {
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+
+        return value;
+    }
+
+    // the main thread's share of a frame: gather visible objects, sort them into draws and label a few for tools.
+    // returns the allocations made by draw_queue::build alone, its sort workers included
+    size_t main_thread_work(eng::draw_queue& queue, std::pmr::memory_resource* resource, uint32_t object_count, uint32_t frame) {
+        queue.begin_frame();
+
+        std::pmr::vector<uint32_t> visible(resource);
+
+        for (uint32_t object = 0; object < object_count; ++object) {
+            if (hash(object ^ (frame * 0x9e3779b9u)) % 4 != 0) {
+                visible.push_back(object);
+            }
+        }
+
+        for (uint32_t object : visible) {
+            queue.submit(hash(object) % 2, object % 8, object % 64, object % 256, static_cast<float>(hash(object) & 0xffff) / 65535.0f, object);
+        }
+
+        size_t allocations_before = allocation_count.load();
+        queue.build(resource);
+        size_t build_allocations = allocation_count.load() - allocations_before;
+
+        std::pmr::unordered_map<uint32_t, std::pmr::string> labels(resource);
+        char label[64];
+
+        for (size_t i = 0; i < visible.size() && i < 256; ++i) {
+            std::snprintf(label, sizeof(label), "visible object %u in frame %u", visible[i], frame);
+            labels.emplace(visible[i], std::pmr::string(label, resource));
+        }
+
+        return build_allocations;
+    }
+
+    // a worker's share: transform a batch whose size isn't known until the frame runs
+    void worker_work(std::pmr::memory_resource* resource, unsigned thread_index, uint32_t frame) {
+        std::pmr::vector<float> transformed(resource);
+        std::pmr::vector<std::pmr::vector<uint32_t>> buckets(16, std::pmr::vector<uint32_t>(resource), resource);
+
+        uint32_t count = 2000 + hash(thread_index * 7919u + frame) % 2000;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            transformed.push_back(static_cast<float>(i) * 0.5f + static_cast<float>(thread_index));
+            buckets[hash(i) % buckets.size()].push_back(i);
+        }
+    }
+
+    struct run_result {
+        // the synthetic workload around the engine calls: visibility list, labels and worker batches
+        double workload_allocations_per_frame;
+        double build_allocations_per_frame;
+        double milliseconds_per_frame;
+    };
+
+    // a headless command buffer that's submitted and waited on every frame, so the streamer's
+    // frames in flight contract holds trivially
+    // returns the allocations update made on the calling thread
+    size_t run_streamer_frame(benchmarks::headless_context& context, const eng::device& device, eng::texture_streamer& streamer,
+        std::pmr::memory_resource* resource) {
+        VkCommandBuffer command_buffer = context.begin_frame();
+
+        size_t allocations_before = thread_allocation_count;
+        streamer.update(device, command_buffer, resource);
+        size_t update_allocations = thread_allocation_count - allocations_before;
+
+        context.submit();
+
+        return update_allocations;
+    }
+
+    // textures whose screen sizes keep changing, so every update has loads to stage and mips to evict
+    void run_streamer(eng::frame_allocator& allocator, uint32_t frame_count, uint32_t warmup_frames) {
+        eng::result<eng::instance> instance_result = eng::instance::create_instance("frame_arena_benchmark", nullptr);
+
+        if (instance_result.is_error()) {
+            std::cout << "texture_streamer::update: skipped, " << instance_result.error_message() << '\n';
+            return;
+        }
+
+        eng::instance instance = std::move(instance_result.unwrap());
+
+        eng::result<eng::device> device_result = eng::device::create_device(instance, nullptr);
+
+        if (device_result.is_error()) {
+            std::cout << "texture_streamer::update: skipped, " << device_result.error_message() << '\n';
+            return;
+        }
+
+        eng::device device = std::move(device_result.unwrap());
+
+        benchmarks::headless_context context;
+
+        if (!context.create(device, device.get_graphics_queue_family(), device.get_vulkan_graphics_queue())) {
+            std::cout << "texture_streamer::update: skipped, failed to create command resources\n";
+            return;
+        }
+
+        eng::result<eng::texture_streamer> streamer_result = eng::texture_streamer::create_texture_streamer(device);
+
+        if (streamer_result.is_error()) {
+            std::cout << "texture_streamer::update: skipped, " << streamer_result.error_message() << '\n';
+            return;
+        }
+
+        eng::texture_streamer streamer = std::move(streamer_result.unwrap());
+
+        constexpr uint32_t texture_count = 64;
+        constexpr uint32_t texture_size = 1024;
+
+        std::vector<eng::texture_streamer::texture_id> ids;
+
+        for (uint32_t i = 0; i < texture_count; ++i) {
+            eng::texture_streamer::texture_description description{};
+            description.width = texture_size;
+            description.height = texture_size;
+            description.mip_count = 11;
+            description.format = VK_FORMAT_R8G8B8A8_UNORM;
+            description.load_mip = [](uint32_t mip, std::vector<uint8_t>& data) {
+                uint32_t size = std::max(1u, texture_size >> mip);
+                data.assign(static_cast<size_t>(size) * size * 4, static_cast<uint8_t>(mip));
+
+                return true;
+            };
+
+            ids.push_back(streamer.add_texture(std::move(description)));
+        }
+
+        for (bool arena : { false, true }) {
+            size_t counted_allocations = 0;
+
+            for (uint32_t frame = 0; frame < warmup_frames + frame_count; ++frame) {
+                for (uint32_t i = 0; i < texture_count; ++i) {
+                    bool zoomed_in = ((frame / 8 + i) % 4) == 0;
+                    streamer.set_screen_size(ids[i], zoomed_in ? static_cast<float>(texture_size) : 32.0f);
+                }
+
+                if (arena) {
+                    allocator.begin_frame();
+                }
+
+                std::pmr::memory_resource* resource = arena ? &allocator.get_thread_arena() : std::pmr::get_default_resource();
+                size_t update_allocations = run_streamer_frame(context, device, streamer, resource);
+
+                if (frame >= warmup_frames) {
+                    counted_allocations += update_allocations;
+                }
+            }
+
+            std::cout << "texture_streamer::update on " << (arena ? "frame arena" : "global heap") << ": "
+                << static_cast<double>(counted_allocations) / frame_count << " mallocs/frame\n";
+        }
+
+        eng::texture_streamer::statistics stats = streamer.get_statistics();
+        std::cout << "  " << texture_count << " textures, " << stats.uploaded_mips << " mips uploaded, " << stats.evicted_mips << " evicted\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t object_count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 32000;
+    uint32_t frame_count = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 240;
+    constexpr unsigned worker_count = 4;
+    constexpr uint32_t warmup_frames = 16;
+
+    // about three quarters of the objects are submitted, which keeps the default above the draw queue's parallel sort threshold
+    eng::draw_queue queue(worker_count);
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        queue.register_pipeline(VK_NULL_HANDLE, VK_NULL_HANDLE);
+    }
+
+    for (uint32_t i = 0; i < 64; ++i) {
+        queue.register_material(VK_NULL_HANDLE);
+    }
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        queue.register_mesh({ VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 0, VK_INDEX_TYPE_UINT32, 36, 0, 0 });
+    }
+
+    eng::frame_allocator allocator;
+    bool use_arena = false;
+    uint32_t frame = 0;
+
+    worker_pool workers(worker_count, [&](unsigned thread_index) {
+        std::pmr::memory_resource* resource = use_arena ? &allocator.get_thread_arena() : std::pmr::get_default_resource();
+        worker_work(resource, thread_index, frame);
+    });
+
+    auto run = [&](bool arena) {
+        use_arena = arena;
+
+        size_t counted_allocations = 0;
+        size_t counted_build_allocations = 0;
+        std::chrono::steady_clock::duration counted_time{};
+
+        for (uint32_t i = 0; i < warmup_frames + frame_count; ++i, ++frame) {
+            size_t allocations_before = allocation_count.load();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            if (arena) {
+                allocator.begin_frame();
+            }
+
+            std::pmr::memory_resource* resource = arena ? &allocator.get_thread_arena() : std::pmr::get_default_resource();
+
+            workers.run_frame();
+            size_t build_allocations = main_thread_work(queue, resource, object_count, frame);
+
+            if (i >= warmup_frames) {
+                counted_time += std::chrono::steady_clock::now() - start;
+                counted_allocations += allocation_count.load() - allocations_before;
+                counted_build_allocations += build_allocations;
+            }
+        }
+
+        return run_result{
+            static_cast<double>(counted_allocations - counted_build_allocations) / frame_count,
+            static_cast<double>(counted_build_allocations) / frame_count,
+            std::chrono::duration<double, std::milli>(counted_time).count() / frame_count
+        };
+    };
+
+    run_result heap_result = run(false);
+    run_result arena_result = run(true);
+
+    eng::frame_allocator::statistics stats = allocator.get_statistics();
+
+    std::cout << "objects: " << object_count << ", draws: " << queue.get_statistics().submitted_draws
+        << ", frames: " << frame_count << ", worker threads: " << worker_count << '\n';
+    std::cout << "draw_queue::build on global heap: " << heap_result.build_allocations_per_frame << " mallocs/frame\n";
+    std::cout << "draw_queue::build on frame arena: " << arena_result.build_allocations_per_frame << " mallocs/frame\n";
+    std::cout << "synthetic workload on global heap: " << heap_result.workload_allocations_per_frame << " mallocs/frame, "
+        << heap_result.milliseconds_per_frame << " ms/frame\n";
+    std::cout << "synthetic workload on frame arena: " << arena_result.workload_allocations_per_frame << " mallocs/frame, "
+        << arena_result.milliseconds_per_frame << " ms/frame\n";
+    std::cout << "arena high water: " << stats.high_water << " bytes over " << stats.thread_count << " threads, "
+        << stats.capacity << " bytes reserved in " << stats.upstream_allocations << " upstream blocks\n";
+
+    run_streamer(allocator, frame_count, warmup_frames);
+
+    return 0;
+}
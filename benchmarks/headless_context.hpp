@@ -0,0 +1,173 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "device.hpp"
+
+namespace benchmarks {
+    // one command buffer per frame, submitted on its own and waited for so the results belong to that frame.
+    // the work recorded between begin_frame and end_timing is timed with a pair of timestamps when the queue supports them
+    class headless_context {
+    public:
+        headless_context() = default;
+
+        headless_context(const headless_context&) = delete;
+        headless_context& operator=(const headless_context&) = delete;
+
+        bool create(const eng::device& device, uint32_t queue_family, VkQueue queue) {
+            logical_device = device.get_vulkan_logical_device();
+            this->queue = queue;
+
+            uint32_t family_count = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, nullptr);
+
+            std::vector<VkQueueFamilyProperties> families(family_count);
+            vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, families.data());
+
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+            // only the low timestampValidBits bits count, the difference is taken modulo that so a wrap between the pair stays small
+            uint32_t valid_bits = families[queue_family].timestampValidBits;
+            timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+            timestamp_period = properties.limits.timestampPeriod;
+            has_timestamps = valid_bits != 0;
+
+            VkCommandPoolCreateInfo pool_create_info{};
+            pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            pool_create_info.queueFamilyIndex = queue_family;
+
+            if (vkCreateCommandPool(logical_device, &pool_create_info, nullptr, &command_pool) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkCommandBufferAllocateInfo allocate_info{};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.commandPool = command_pool;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(logical_device, &allocate_info, &command_buffer) != VK_SUCCESS) {
+                return false;
+            }
+
+            VkFenceCreateInfo fence_create_info{};
+            fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            if (vkCreateFence(logical_device, &fence_create_info, nullptr, &fence) != VK_SUCCESS) {
+                return false;
+            }
+
+            if (!has_timestamps) {
+                return true;
+            }
+
+            VkQueryPoolCreateInfo query_create_info{};
+            query_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_create_info.queryCount = 2;
+
+            return vkCreateQueryPool(logical_device, &query_create_info, nullptr, &query_pool) == VK_SUCCESS;
+        }
+
+        ~headless_context() {
+            if (logical_device == VK_NULL_HANDLE) {
+                return;
+            }
+
+            vkDeviceWaitIdle(logical_device);
+
+            if (query_pool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(logical_device, query_pool, nullptr);
+            }
+
+            if (fence != VK_NULL_HANDLE) {
+                vkDestroyFence(logical_device, fence, nullptr);
+            }
+
+            if (command_pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(logical_device, command_pool, nullptr);
+            }
+        }
+
+        // resets the command buffer and starts the timed region
+        VkCommandBuffer begin_frame() {
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+            vkResetCommandBuffer(command_buffer, 0);
+            vkBeginCommandBuffer(command_buffer, &begin_info);
+
+            if (has_timestamps) {
+                vkCmdResetQueryPool(command_buffer, query_pool, 0, 2);
+                vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, 0);
+            }
+
+            timing = true;
+
+            return command_buffer;
+        }
+
+        // commands recorded after this, like readbacks, aren't part of the gpu time
+        void end_timing() {
+            if (has_timestamps && timing) {
+                vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+            }
+
+            timing = false;
+        }
+
+        // ends the timed region if it's still open, then submits the frame and waits for it
+        bool submit() {
+            end_timing();
+            vkEndCommandBuffer(command_buffer);
+
+            VkSubmitInfo submit_info{};
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &command_buffer;
+
+            vkResetFences(logical_device, 1, &fence);
+
+            if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS) {
+                return false;
+            }
+
+            vkWaitForFences(logical_device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+            gpu_milliseconds = 0.0;
+
+            if (has_timestamps) {
+                uint64_t timestamps[2];
+                vkGetQueryPoolResults(logical_device, query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+                gpu_milliseconds = static_cast<double>((timestamps[1] - timestamps[0]) & timestamp_mask) * timestamp_period / 1e6;
+            }
+
+            return true;
+        }
+
+        bool timestamps_supported() const { return has_timestamps; }
+
+        // the timed region of the last submitted frame, zero without timestamps
+        double get_gpu_milliseconds() const { return gpu_milliseconds; }
+    private:
+        VkDevice logical_device = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkQueryPool query_pool = VK_NULL_HANDLE;
+        uint64_t timestamp_mask = ~0ull;
+        float timestamp_period = 1.0f;
+        double gpu_milliseconds = 0.0;
+        bool has_timestamps = false;
+        bool timing = false;
+    };
+}
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "compute_pipeline.hpp"
+#include "device.hpp"
+#include "headless_context.hpp"
+#include "instance.hpp"
+#include "light_clusters.hpp"
+
+// bins random point lights headless on the graphics queue and reports gpu time per cull and lights per cluster.
+// usage: light_cluster_benchmark [frames]
+namespace {
+    constexpr uint32_t width = 1920;
+    constexpr uint32_t height = 1080;
+    constexpr float near_plane = 0.1f;
+    constexpr float far_plane = 200.0f;
+
+    struct run_result {
+        double gpu_milliseconds;
+        double cpu_milliseconds;
+    };
+
+    // records one cull and waits for it, so the statistics belong to this frame
+    run_result run_frame(benchmarks::headless_context& context, eng::light_clusters& clusters, const glm::mat4& view, const glm::mat4& projection) {
+        VkCommandBuffer command_buffer = context.begin_frame();
+
+        auto cpu_start = std::chrono::steady_clock::now();
+        clusters.record_cull(command_buffer, view, projection, near_plane, far_plane, width, height);
+        auto cpu_end = std::chrono::steady_clock::now();
+
+        context.submit();
+
+        run_result result{};
+        result.cpu_milliseconds = std::chrono::duration<double, std::milli>(cpu_end - cpu_start).count();
+        result.gpu_milliseconds = context.get_gpu_milliseconds();
+
+        return result;
+    }
+
+    // lights fill a box around the view frustum, so some of them are culled and the rest spread over every depth slice
+    std::vector<eng::light_clusters::light> random_lights(uint32_t count) {
+        std::mt19937 generator(count);
+        std::uniform_real_distribution<float> x(-120.0f, 120.0f);
+        std::uniform_real_distribution<float> y(-70.0f, 70.0f);
+        std::uniform_real_distribution<float> z(-far_plane, 0.0f);
+        std::uniform_real_distribution<float> radius(1.0f, 5.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<eng::light_clusters::light> lights(count);
+
+        for (eng::light_clusters::light& light : lights) {
+            light.position = glm::vec3(x(generator), y(generator), z(generator));
+            light.radius = radius(generator);
+            light.color = glm::vec3(unit(generator), unit(generator), unit(generator));
+            light.intensity = 1.0f;
+        }
+
+        return lights;
+    }
+
+    void run(benchmarks::headless_context& context, eng::light_clusters& clusters, uint32_t light_count, uint32_t frames) {
+        clusters.set_lights(random_lights(light_count));
+
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), static_cast<float>(width) / height, near_plane, far_plane);
+
+        run_frame(context, clusters, view, projection);
+
+        double gpu_total = 0.0;
+        double cpu_total = 0.0;
+
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            run_result result = run_frame(context, clusters, view, projection);
+
+            gpu_total += result.gpu_milliseconds;
+            cpu_total += result.cpu_milliseconds;
+        }
+
+        // the scene doesn't move, so the last frame's counts hold for all of them
+        eng::light_clusters::statistics stats = clusters.get_statistics();
+        double references = static_cast<double>(stats.light_references);
+
+        std::cout << "lights " << light_count
+            << "  record " << cpu_total / frames << " ms";
+
+        if (context.timestamps_supported() && gpu_total > 0.0) {
+            std::cout << "  gpu " << gpu_total / frames << " ms";
+        }
+        else {
+            std::cout << "  gpu timestamps unavailable";
+        }
+
+        std::cout << "  lights/cluster " << references / clusters.get_cluster_count()
+            << "  lights/non-empty cluster " << (stats.non_empty_clusters > 0 ? references / stats.non_empty_clusters : 0.0)
+            << "  max " << stats.max_lights_per_cluster
+            << "  overflowed " << stats.overflowed_references << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100;
+
+    if (frames == 0) {
+        std::cerr << "usage: light_cluster_benchmark [frames]" << std::endl;
+        return 1;
+    }
+
+    eng::result<eng::instance> instance_result = eng::instance::create_instance("light_cluster_benchmark", nullptr);
+
+    if (instance_result.is_error()) {
+        std::cerr << instance_result.error_message() << std::endl;
+        return 1;
+    }
+
+    eng::instance instance = std::move(instance_result.unwrap());
+
+    eng::result<eng::device> device_result = eng::device::create_device(instance, nullptr);
+
+    if (device_result.is_error()) {
+        std::cerr << device_result.error_message() << std::endl;
+        return 1;
+    }
+
+    eng::device device = std::move(device_result.unwrap());
+
+    const uint32_t light_counts[] = { 1000, 10000, 50000 };
+    const glm::uvec3 grid(16, 9, 24);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    std::cout << properties.deviceName << ", " << width << "x" << height
+        << ", grid " << grid.x << "x" << grid.y << "x" << grid.z << ", " << frames << " frames" << std::endl;
+
+    benchmarks::headless_context context;
+
+    if (!context.create(device, device.get_graphics_queue_family(), device.get_vulkan_graphics_queue())) {
+        std::cerr << "Failed to create benchmark resources." << std::endl;
+        return 1;
+    }
+
+    // room for 1024 lights per cluster on average, so even the densest run reports its real counts
+    eng::result<eng::light_clusters> clusters_result = eng::light_clusters::create_light_clusters(device, light_counts[2],
+        grid, grid.x * grid.y * grid.z * 1024);
+
+    if (clusters_result.is_error()) {
+        std::cerr << clusters_result.error_message() << std::endl;
+        return 1;
+    }
+
+    eng::light_clusters clusters = std::move(clusters_result.unwrap());
+
+    for (uint32_t light_count : light_counts) {
+        run(context, clusters, light_count, frames);
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "buffer.hpp"
+#include "capture.hpp"
+#include "compute_pipeline.hpp"
+#include "device.hpp"
+#include "headless_context.hpp"
+#include "instance.hpp"
+#include "particle_system.hpp"
+
+// runs the particle system headless on the compute queue and reports gpu time per update.
+// usage: particle_benchmark [capacity] [frames] [capture file]
+namespace {
+    struct run_result {
+        double gpu_milliseconds;
+        double cpu_milliseconds;
+        uint32_t alive;
+    };
+
+    // records one update and waits for it, the alive count is copied out after the timed region only so the benchmark can print it
+    run_result run_frame(benchmarks::headless_context& context, const eng::buffer& readback_buffer, eng::particle_system& particles, float delta_time) {
+        VkCommandBuffer command_buffer = context.begin_frame();
+
+        auto cpu_start = std::chrono::steady_clock::now();
+        particles.record_update(command_buffer, delta_time, glm::vec3(0.0f, 5.0f, -30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        auto cpu_end = std::chrono::steady_clock::now();
+
+        context.end_timing();
+
+        eng::compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+        VkBufferCopy copy{ 0, 0, sizeof(uint32_t) };
+        eng::compute_pipeline::record_copy_buffer(command_buffer, particles.get_counter_buffer(), readback_buffer, copy);
+
+        context.submit();
+
+        eng::capture::end_frame();
+
+        run_result result{};
+        result.cpu_milliseconds = std::chrono::duration<double, std::milli>(cpu_end - cpu_start).count();
+        result.gpu_milliseconds = context.get_gpu_milliseconds();
+        result.alive = *static_cast<const uint32_t*>(readback_buffer.get_mapped_data());
+
+        return result;
+    }
+
+    void run(benchmarks::headless_context& context, const eng::buffer& readback_buffer, eng::particle_system& particles, uint32_t frames, bool sorting) {
+        const float delta_time = 1.0f / 60.0f;
+
+        particles.set_sorting(sorting);
+
+        // fill the system to capacity first, lifetimes are long enough that nothing dies during the measurement
+        eng::particle_system::emitter emitter;
+        emitter.radius = 2.0f;
+        emitter.velocity = glm::vec3(0.0f, 4.0f, 0.0f);
+        emitter.spread = 2.0f;
+        emitter.lifetime_min = 1000.0f;
+        emitter.lifetime_max = 2000.0f;
+        particles.set_emitter(emitter);
+        particles.emit(particles.get_capacity());
+
+        run_frame(context, readback_buffer, particles, delta_time);
+
+        double gpu_total = 0.0;
+        double cpu_total = 0.0;
+        uint64_t simulated = 0;
+        uint32_t alive = 0;
+
+        for (uint32_t frame = 0; frame < frames; ++frame) {
+            run_result result = run_frame(context, readback_buffer, particles, delta_time);
+
+            gpu_total += result.gpu_milliseconds;
+            cpu_total += result.cpu_milliseconds;
+            simulated += result.alive;
+            alive = result.alive;
+        }
+
+        std::cout << (sorting ? "simulate + sort" : "simulate       ")
+            << "  alive " << alive
+            << "  record " << cpu_total / frames << " ms";
+
+        if (context.timestamps_supported() && gpu_total > 0.0) {
+            std::cout << "  gpu " << gpu_total / frames << " ms"
+                << "  " << static_cast<double>(simulated) / gpu_total << " particles/ms";
+        }
+        else {
+            std::cout << "  gpu timestamps unavailable";
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t capacity = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : (1u << 21);
+    uint32_t frames = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 100;
+
+    if (capacity == 0 || frames == 0) {
+        std::cerr << "usage: particle_benchmark [capacity] [frames]" << std::endl;
+        return 1;
+    }
+
+    eng::result<eng::instance> instance_result = eng::instance::create_instance("particle_benchmark", nullptr);
+
+    if (instance_result.is_error()) {
+        std::cerr << instance_result.error_message() << std::endl;
+        return 1;
+    }
+
+    eng::instance instance = std::move(instance_result.unwrap());
+
+    eng::result<eng::device> device_result = eng::device::create_device(instance, nullptr);
+
+    if (device_result.is_error()) {
+        std::cerr << device_result.error_message() << std::endl;
+        return 1;
+    }
+
+    eng::device device = std::move(device_result.unwrap());
+
+    // the capture has to exist before any of the objects it should be able to replay
+    eng::capture capture;
+
+    if (argc > 3) {
+        eng::result<eng::capture> capture_result = eng::capture::create_capture(device, argv[3]);
+
+        if (capture_result.is_error()) {
+            std::cerr << capture_result.error_message() << std::endl;
+            return 1;
+        }
+
+        capture = std::move(capture_result.unwrap());
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    std::cout << properties.deviceName << (device.has_async_compute() ? ", async compute queue" : ", graphics queue")
+        << ", capacity " << capacity << ", " << frames << " frames" << std::endl;
+
+    int exit_code = 0;
+
+    {
+        benchmarks::headless_context context;
+
+        if (!context.create(device, device.get_compute_queue_family(), device.get_vulkan_compute_queue())) {
+            std::cerr << "Failed to create benchmark resources." << std::endl;
+            return 1;
+        }
+
+        eng::result<eng::buffer> readback_result = eng::buffer::create_buffer(device, sizeof(uint32_t),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        if (readback_result.is_error()) {
+            std::cerr << readback_result.error_message() << std::endl;
+            return 1;
+        }
+
+        eng::buffer readback_buffer = std::move(readback_result.unwrap());
+
+        for (bool sorting : { false, true }) {
+            eng::result<eng::particle_system> particles_result = eng::particle_system::create_particle_system(device, capacity);
+
+            if (particles_result.is_error()) {
+                std::cerr << particles_result.error_message() << std::endl;
+                exit_code = 1;
+                break;
+            }
+
+            eng::particle_system particles = std::move(particles_result.unwrap());
+            run(context, readback_buffer, particles, frames, sorting);
+
+            vkDeviceWaitIdle(device.get_vulkan_logical_device());
+        }
+    }
+
+    if (capture.valid()) {
+        capture.finish();
+
+        eng::capture::statistics stats = capture.get_statistics();
+        std::cout << "captured " << stats.frames << " frames, " << stats.records << " records, " << stats.bytes << " bytes" << std::endl;
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "device.hpp"
+
+namespace eng {
+    class buffer {
+    public:
+        // concurrent buffers can be used from both the graphics and the async compute queue without ownership transfers
+        static result<buffer> create_buffer(const device& device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool concurrent = false);
+
+        buffer();
+        ~buffer();
+
+        buffer(const buffer&) = delete;
+        buffer& operator=(const buffer&) = delete;
+
+        buffer(buffer&& other) noexcept;
+        buffer& operator=(buffer&& other) noexcept;
+
+        bool valid() const { return buffer_handle != VK_NULL_HANDLE; }
+
+        // copies into the persistently mapped memory, only valid for host visible buffers. writes through
+        // get_mapped_data() bypass an active capture
+        void write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+        void* get_mapped_data() const { return mapped_data; }
+        VkDeviceSize get_size() const { return size; }
+        VkBuffer get_vulkan_buffer() const { return buffer_handle; }
+    private:
+        buffer(VkDevice logical_device_handle, VkBuffer buffer_handle, VkDeviceMemory memory_handle, VkDeviceSize size, void* mapped_data);
+
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkBuffer buffer_handle;
+        VkDeviceMemory memory_handle;
+        VkDeviceSize size;
+        void* mapped_data;
+    };
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "device.hpp"
+
+namespace eng {
+    // records buffer creation and uploads, compute pipelines, descriptor sets and the compute and buffer transfer
+    // commands recorded through the engine into a compact binary file, which replayer re-executes headlessly.
+    // draws, image copies and image barriers need the application's render passes, graphics pipelines and images,
+    // so they're only counted. objects created before the capture starts can't be replayed, so it should be created right after the device
+    class capture {
+    public:
+        enum class record_type : uint8_t {
+            create_buffer,
+            destroy_buffer,
+            write_buffer,
+            create_shader,
+            create_compute_pipeline,
+            destroy_pipeline,
+            create_descriptor_layout,
+            destroy_descriptor_layout,
+            allocate_descriptor_set,
+            write_descriptor_buffer,
+            bind_pipeline,
+            bind_descriptor_set,
+            push_constants,
+            dispatch,
+            dispatch_indirect,
+            pipeline_barrier,
+            fill_buffer,
+            copy_buffer,
+            update_buffer,
+            // image descriptors aren't captured, the replayer drops the set so commands using it are skipped
+            write_descriptor_image,
+            unreplayable_command,
+            end_frame
+        };
+
+        enum class unreplayable_kind : uint32_t {
+            draw,
+            draw_indirect,
+            draw_indirect_count,
+            copy_to_image,
+            image_barrier
+        };
+
+        static constexpr uint32_t unreplayable_kind_count = 5;
+
+        // every file starts with the magic, the version and the name of the device it was captured on,
+        // followed by records of a type byte, a payload size and the payload
+        static constexpr char magic[8] = { 'E', 'N', 'G', 'C', 'A', 'P', 'T', 'R' };
+        static constexpr uint32_t format_version = 2;
+        static constexpr size_t device_name_size = 256;
+
+        struct statistics {
+            uint64_t frames;
+            uint64_t records;
+            uint64_t bytes;
+            // commands that used an object created before the capture started, the replayer skips them
+            uint64_t missing_references;
+            // draws and image commands that were only counted
+            uint64_t unreplayable_commands;
+        };
+
+        // only one capture can be active at a time, engine calls on any thread are recorded into it until finish
+        static result<capture> create_capture(const device& device, const char* path);
+
+        // marks a frame boundary, the replayer submits everything recorded since the previous one together.
+        // does nothing without an active capture
+        static void end_frame();
+
+        static bool active();
+
+        capture();
+        ~capture();
+
+        capture(const capture&) = delete;
+        capture& operator=(const capture&) = delete;
+
+        capture(capture&& other) noexcept;
+        capture& operator=(capture&& other) noexcept;
+
+        bool valid() const { return shared != nullptr; }
+
+        // flushes and closes the file, later engine calls are no longer recorded
+        void finish();
+
+        statistics get_statistics() const;
+
+        // called by the engine objects, they return straight away when no capture is active
+        static void record_create_buffer(VkBuffer buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool concurrent);
+        static void record_destroy_buffer(VkBuffer buffer);
+        static void record_write_buffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset);
+        static void record_create_compute_pipeline(VkPipeline pipeline, const std::vector<uint32_t>& code, const std::vector<VkDescriptorSetLayout>& set_layouts,
+            uint32_t push_constant_size, const std::vector<uint32_t>& specialization_constants);
+        static void record_destroy_pipeline(VkPipeline pipeline);
+        static void record_create_descriptor_layout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t max_sets);
+        static void record_destroy_descriptor_layout(VkDescriptorSetLayout layout);
+        static void record_allocate_descriptor_set(VkDescriptorSet set, VkDescriptorSetLayout layout);
+        static void record_write_descriptor_buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+        static void record_bind_pipeline(VkCommandBuffer command_buffer, VkPipeline pipeline);
+        static void record_bind_descriptor_set(VkCommandBuffer command_buffer, VkPipeline pipeline, uint32_t index, VkDescriptorSet set);
+        static void record_push_constants(VkCommandBuffer command_buffer, VkPipeline pipeline, const void* data, uint32_t size, uint32_t offset);
+        static void record_dispatch(VkCommandBuffer command_buffer, uint32_t x, uint32_t y, uint32_t z);
+        static void record_dispatch_indirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset);
+        static void record_pipeline_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags source_stages, VkPipelineStageFlags destination_stages,
+            VkAccessFlags source_access, VkAccessFlags destination_access);
+        static void record_fill_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value);
+        static void record_copy_buffer(VkCommandBuffer command_buffer, VkBuffer source, VkBuffer destination, const VkBufferCopy& region);
+        static void record_update_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset);
+        static void record_write_descriptor_image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type);
+        // count is the number of vkCmd calls, so a loop of draws can be recorded once
+        static void record_unreplayable(VkCommandBuffer command_buffer, unreplayable_kind kind, uint32_t count = 1);
+    private:
+        enum object_kind : uint32_t {
+            buffer_object,
+            pipeline_object,
+            layout_object,
+            set_object,
+            command_buffer_object,
+            object_kind_count
+        };
+
+        // shared with the hooks, a hook that's still writing keeps it alive after the capture is finished or destroyed
+        struct capture_state {
+            std::mutex mutex;
+            std::ofstream file;
+            std::chrono::steady_clock::time_point start_time;
+            // handles are mapped to small ids, destroyed handles are forgotten so a reused handle gets a new id
+            std::unordered_map<uint64_t, uint32_t> ids[object_kind_count];
+            uint32_t next_id;
+            // shader code is written once and referenced by hash
+            std::unordered_map<uint64_t, uint32_t> shader_ids;
+            std::vector<uint8_t> payload;
+            statistics stats;
+        };
+
+        // the lock is declared last so it's released before the reference
+        struct locked_state {
+            std::shared_ptr<capture_state> state;
+            std::unique_lock<std::mutex> lock;
+
+            explicit operator bool() const { return state != nullptr; }
+            capture_state& operator*() const { return *state; }
+            capture_state* operator->() const { return state.get(); }
+        };
+
+        // returns the active state with its mutex held, or an empty one when nothing is being captured
+        static locked_state acquire();
+        static uint32_t create_id(capture_state& state, object_kind kind, uint64_t handle);
+        static uint32_t find_id(capture_state& state, object_kind kind, uint64_t handle);
+        static uint32_t release_id(capture_state& state, object_kind kind, uint64_t handle);
+        static void write_record(capture_state& state, record_type type);
+
+        void destroy();
+
+        // only accessed through the std::atomic_ shared_ptr functions, which take a lock in libstdc++,
+        // so hooks check the flag first and pay a single relaxed load when nothing is captured
+        static std::shared_ptr<capture_state> active_state;
+        static std::atomic<bool> capturing;
+
+        std::shared_ptr<capture_state> shared;
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "shader_module.hpp"
+
+namespace eng {
+    // a compute shader with its pipeline layout, descriptor sets and push constants are recorded through it
+    class compute_pipeline {
+    public:
+        // specialization constant i is set to specialization_constants[i]
+        static result<compute_pipeline> create_compute_pipeline(const device& device, const char* shader_path,
+            const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size = 0,
+            const std::vector<uint32_t>& specialization_constants = {});
+        // loads shader_directory/shader_name
+        static result<compute_pipeline> create_compute_pipeline(const device& device, const char* shader_directory, const char* shader_name,
+            const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size = 0,
+            const std::vector<uint32_t>& specialization_constants = {});
+        static result<compute_pipeline> create_compute_pipeline(const device& device, const std::vector<uint32_t>& code,
+            const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size = 0,
+            const std::vector<uint32_t>& specialization_constants = {});
+
+        // workgroups needed to cover invocations with a local size of group_size
+        static uint32_t group_count(uint32_t invocations, uint32_t group_size) { return (invocations + group_size - 1) / group_size; }
+
+        // makes compute writes visible to later dispatches and indirect argument reads
+        static void record_barrier(VkCommandBuffer command_buffer);
+        static void record_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags source_stages, VkPipelineStageFlags destination_stages,
+            VkAccessFlags source_access, VkAccessFlags destination_access);
+
+        // transfer commands that go into the same stream as dispatches, so they're seen by an active capture
+        static void record_fill_buffer(VkCommandBuffer command_buffer, const buffer& buffer, uint32_t value);
+        static void record_copy_buffer(VkCommandBuffer command_buffer, const buffer& source, const buffer& destination, const VkBufferCopy& region);
+        // inline upload through vkCmdUpdateBuffer, size must be a multiple of 4 and at most 65536 bytes
+        static void record_update_buffer(VkCommandBuffer command_buffer, const buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+        compute_pipeline();
+        ~compute_pipeline();
+
+        compute_pipeline(const compute_pipeline&) = delete;
+        compute_pipeline& operator=(const compute_pipeline&) = delete;
+
+        compute_pipeline(compute_pipeline&& other) noexcept;
+        compute_pipeline& operator=(compute_pipeline&& other) noexcept;
+
+        bool valid() const { return pipeline_handle != VK_NULL_HANDLE; }
+
+        void bind(VkCommandBuffer command_buffer) const;
+        void bind_descriptor_set(VkCommandBuffer command_buffer, uint32_t index, VkDescriptorSet set) const;
+
+        void push_constants(VkCommandBuffer command_buffer, const void* data, uint32_t size, uint32_t offset = 0) const;
+
+        template <typename T>
+        void push_constants(VkCommandBuffer command_buffer, const T& data) const {
+            push_constants(command_buffer, &data, static_cast<uint32_t>(sizeof(T)));
+        }
+
+        void dispatch(VkCommandBuffer command_buffer, uint32_t x, uint32_t y = 1, uint32_t z = 1) const;
+
+        // the buffer holds a VkDispatchIndirectCommand at offset and needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+        void dispatch_indirect(VkCommandBuffer command_buffer, const buffer& arguments, VkDeviceSize offset = 0) const;
+
+        uint32_t get_push_constant_size() const { return push_constant_size; }
+        VkPipelineLayout get_vulkan_pipeline_layout() const { return pipeline_layout_handle; }
+        VkPipeline get_vulkan_pipeline() const { return pipeline_handle; }
+    private:
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkPipelineLayout pipeline_layout_handle;
+        VkPipeline pipeline_handle;
+        uint32_t push_constant_size;
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "compute_pipeline.hpp"
+#include "descriptor_layout.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // hierarchical depth buffer built by repeatedly reducing the depth buffer in a compute pass,
+    // each texel holds the farthest depth of the region it covers so bounds can be tested conservatively
+    class depth_pyramid {
+    public:
+        static result<depth_pyramid> create_depth_pyramid(const device& device, uint32_t width, uint32_t height, bool reversed_z = false, const char* shader_path = ENG_SHADER_DIRECTORY "/depth_reduce.comp.spv");
+
+        depth_pyramid();
+        ~depth_pyramid();
+
+        depth_pyramid(const depth_pyramid&) = delete;
+        depth_pyramid& operator=(const depth_pyramid&) = delete;
+
+        depth_pyramid(depth_pyramid&& other) noexcept;
+        depth_pyramid& operator=(depth_pyramid&& other) noexcept;
+
+        bool valid() const { return reduce_pipeline.valid(); }
+
+        // rewrites the first reduction's descriptor, so it must not be called while a build is in flight
+        void set_depth_source(const device& device, VkImageView depth_view, VkImageLayout depth_layout);
+
+        // must be recorded outside of a render pass after the depth prepass, with the depth image in the layout given to set_depth_source
+        void record_build(VkCommandBuffer command_buffer);
+
+        // gpu time of the most recent completed build, or a negative value if none is available yet
+        double get_build_milliseconds();
+
+        uint32_t get_width() const { return width; }
+        uint32_t get_height() const { return height; }
+        uint32_t get_level_count() const { return level_count; }
+        bool is_reversed_z() const { return reversed_z; }
+        VkImageView get_vulkan_image_view() const { return image_view_handle; }
+        VkSampler get_vulkan_sampler() const { return sampler_handle; }
+    private:
+        struct reduce_constants {
+            uint32_t source_width;
+            uint32_t source_height;
+            uint32_t destination_width;
+            uint32_t destination_height;
+            uint32_t reduce_min;
+        };
+
+        static constexpr uint32_t workgroup_size = 8;
+
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkImage image_handle;
+        VkDeviceMemory memory_handle;
+        VkImageView image_view_handle;
+        std::vector<VkImageView> level_view_handles;
+        VkSampler sampler_handle;
+        VkQueryPool query_pool_handle;
+
+        // one set per level, level n samples level n - 1 and writes level n
+        descriptor_layout reduce_layout;
+        std::vector<VkDescriptorSet> reduce_sets;
+        compute_pipeline reduce_pipeline;
+
+        uint32_t width;
+        uint32_t height;
+        uint32_t level_count;
+        bool reversed_z;
+        bool initialized;
+        bool has_depth_source;
+        bool query_pending;
+        uint64_t timestamp_mask;
+        double timestamp_period;
+        double build_milliseconds;
+    };
+}
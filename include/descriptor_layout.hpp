@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // a descriptor set layout together with a pool sized for a fixed number of sets of that layout
+    class descriptor_layout {
+    public:
+        struct binding {
+            uint32_t binding;
+            VkDescriptorType type;
+            VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT;
+            uint32_t count = 1;
+        };
+
+        static result<descriptor_layout> create_descriptor_layout(const device& device, const std::vector<binding>& bindings, uint32_t max_sets = 1);
+
+        descriptor_layout();
+        ~descriptor_layout();
+
+        descriptor_layout(const descriptor_layout&) = delete;
+        descriptor_layout& operator=(const descriptor_layout&) = delete;
+
+        descriptor_layout(descriptor_layout&& other) noexcept;
+        descriptor_layout& operator=(descriptor_layout&& other) noexcept;
+
+        bool valid() const { return descriptor_set_layout_handle != VK_NULL_HANDLE; }
+
+        // sets live until the layout is destroyed, allocating more than max_sets fails
+        result<VkDescriptorSet> allocate_set();
+
+        uint32_t get_max_sets() const { return max_sets; }
+        uint32_t get_allocated_sets() const { return allocated_sets; }
+        VkDescriptorSetLayout get_vulkan_descriptor_set_layout() const { return descriptor_set_layout_handle; }
+    private:
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkDescriptorSetLayout descriptor_set_layout_handle;
+        VkDescriptorPool descriptor_pool_handle;
+        uint32_t max_sets;
+        uint32_t allocated_sets;
+    };
+
+    // batches descriptor writes so a set, or several, are filled with a single vkUpdateDescriptorSets
+    class descriptor_writer {
+    public:
+        descriptor_writer& write_buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        descriptor_writer& write_storage_buffer(VkDescriptorSet set, uint32_t binding, const buffer& buffer);
+        descriptor_writer& write_uniform_buffer(VkDescriptorSet set, uint32_t binding, const buffer& buffer);
+        descriptor_writer& write_image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView image_view, VkSampler sampler, VkImageLayout layout);
+
+        // the sets must not be in use by a pending submission. an active capture records buffer descriptors,
+        // image descriptors only mark the set so the replayer skips commands that use it
+        void update(const device& device);
+
+        bool empty() const { return writes.empty(); }
+    private:
+        // info pointers are resolved in update, the info vectors may reallocate while writes are added
+        struct pending_write {
+            VkWriteDescriptorSet write;
+            size_t info_index;
+            bool image;
+        };
+
+        std::vector<pending_write> writes;
+        std::vector<VkWriteDescriptorSet> resolved_writes;
+        std::vector<VkDescriptorBufferInfo> buffer_infos;
+        std::vector<VkDescriptorImageInfo> image_infos;
+    };
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cstdint>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -15,6 +17,7 @@ namespace eng {
 
     class device {
     public:
+        // a null window creates a headless device with no present queue or swap chain, for compute and offscreen work
         static result<device> create_device(instance& instance, GLFWwindow* window, bool debug_layers = false);
 
         device();
@@ -26,16 +29,46 @@ namespace eng {
         device(device&& other) noexcept;
         device& operator=(device&& other) noexcept;
 
+        struct features {
+            bool multi_draw_indirect = false;
+            bool draw_indirect_first_instance = false;
+            bool draw_indirect_count = false;
+            bool memory_budget = false;
+        };
+
+        struct heap_budget {
+            VkDeviceSize size;
+            VkDeviceSize budget;
+            VkDeviceSize usage;
+            bool device_local;
+        };
+
         bool valid() const { return logical_device_handle != VK_NULL_HANDLE; }
 
+        result<uint32_t> find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+
+        // per heap budget and usage from VK_EXT_memory_budget, or 80% of each heap with unknown usage without it
+        std::vector<heap_budget> query_memory_budget() const;
+        // refills budgets in place, so a caller that queries every frame doesn't allocate once it has been sized
+        void query_memory_budget(std::vector<heap_budget>& budgets) const;
+
+        VkPhysicalDevice get_vulkan_physical_device() const { return physical_device_handle; }
         VkDevice get_vulkan_logical_device() const { return logical_device_handle; }
+        VkQueue get_vulkan_graphics_queue() const { return graphics_queue_handle; }
+        uint32_t get_graphics_queue_family() const { return graphics_queue_family; }
+        // a queue from a compute only family when the device has one, otherwise the graphics queue
+        VkQueue get_vulkan_compute_queue() const { return compute_queue_handle; }
+        uint32_t get_compute_queue_family() const { return compute_queue_family; }
+        bool has_async_compute() const { return compute_queue_family != graphics_queue_family; }
         VkSwapchainKHR get_vulkan_swap_chain() const { return swap_chain_handle; }
+        const features& get_features() const { return enabled_features; }
     private:
         struct queue_family_indices {
             std::optional<uint32_t> graphics_family;
             std::optional<uint32_t> present_family;
+            std::optional<uint32_t> compute_family;
 
-            bool complete() const noexcept { return graphics_family.has_value(); }
+            bool complete() const noexcept { return graphics_family.has_value() && compute_family.has_value(); }
         };
 
         struct swap_chain_support_details {
@@ -44,10 +77,10 @@ namespace eng {
             std::vector<VkPresentModeKHR> present_modes;
         };
 
-        device(VkDevice logical_deivice_handle, VkQueue present_queue_handle, VkSwapchainKHR swap_chain_handle);
+        device(VkPhysicalDevice physical_device_handle, VkDevice logical_device_handle, VkQueue graphics_queue_handle, uint32_t graphics_queue_family, VkQueue compute_queue_handle, uint32_t compute_queue_family, VkQueue present_queue_handle, VkSwapchainKHR swap_chain_handle, features enabled_features, PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2);
 
         static result<VkPhysicalDevice> pick_physical_device(VkInstance instance, VkSurfaceKHR surface);
-        static result<VkDevice> create_logical_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, bool debug_layers = false);
+        static result<VkDevice> create_logical_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, const features& enabled_features, bool debug_layers = false);
         static result<VkSwapchainKHR> create_swap_chain(VkPhysicalDevice physical_device, VkDevice logical_device, VkSurfaceKHR surface, GLFWwindow* window);
 
         static result<queue_family_indices> find_queue_families(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
@@ -55,6 +88,8 @@ namespace eng {
         static bool is_device_suitable(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
         static int rate_device_suitability(VkPhysicalDevice physical_device);
         static bool check_device_extension_support(VkPhysicalDevice physical_device);
+        static bool check_device_extension_support(VkPhysicalDevice physical_device, const char* extension_name);
+        static features query_supported_features(VkPhysicalDevice physical_device);
 
         static swap_chain_support_details query_swap_chain_support(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
 
@@ -62,8 +97,15 @@ namespace eng {
         static VkPresentModeKHR choose_swap_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes);
         static VkExtent2D choose_swap_extent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
 
+        VkPhysicalDevice physical_device_handle;
         VkDevice logical_device_handle;
+        VkQueue graphics_queue_handle;
+        uint32_t graphics_queue_family;
+        VkQueue compute_queue_handle;
+        uint32_t compute_queue_family;
         VkQueue present_queue_handle;
         VkSwapchainKHR swap_chain_handle;
+        features enabled_features;
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2;
     };
 }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace eng {
+    // collects draws for a frame, orders them by a packed 64 bit sort key so state changes are
+    // minimised, and merges runs of the same mesh and material into single instanced draws
+    class draw_queue {
+    public:
+        // key layout from most to least significant: pass, pipeline, material, mesh, depth
+        static constexpr uint32_t pass_bits = 4;
+        static constexpr uint32_t pipeline_bits = 12;
+        static constexpr uint32_t material_bits = 16;
+        static constexpr uint32_t mesh_bits = 16;
+        static constexpr uint32_t depth_bits = 16;
+
+        struct mesh {
+            VkBuffer vertex_buffer;
+            VkDeviceSize vertex_buffer_offset;
+            VkBuffer index_buffer;
+            VkDeviceSize index_buffer_offset;
+            VkIndexType index_type;
+            uint32_t index_count;
+            uint32_t first_index;
+            int32_t vertex_offset;
+        };
+
+        struct batch {
+            uint64_t key;
+            uint32_t first_instance;
+            uint32_t instance_count;
+        };
+
+        struct statistics {
+            uint32_t submitted_draws;
+            uint32_t recorded_draws;
+            uint32_t draws_saved;
+            uint32_t pipeline_binds;
+            uint32_t descriptor_binds;
+            uint32_t vertex_buffer_binds;
+            uint32_t index_buffer_binds;
+            // what the same draws would have cost in submission order without sorting or merging
+            uint32_t unsorted_pipeline_binds;
+            uint32_t unsorted_descriptor_binds;
+            uint32_t unsorted_vertex_buffer_binds;
+        };
+
+        static uint64_t make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+        // sorts above the threshold run on thread_count threads, the calling one and a pool that's created on
+        // the first such build and lives as long as the queue
+        explicit draw_queue(unsigned thread_count = 0);
+        ~draw_queue();
+
+        draw_queue(const draw_queue&) = delete;
+        draw_queue& operator=(const draw_queue&) = delete;
+
+        draw_queue(draw_queue&& other) noexcept;
+        draw_queue& operator=(draw_queue&& other) noexcept;
+
+        uint32_t register_pipeline(VkPipeline pipeline, VkPipelineLayout pipeline_layout);
+        uint32_t register_material(VkDescriptorSet descriptor_set, uint32_t set_index = 0);
+        uint32_t register_mesh(const mesh& mesh);
+
+        void begin_frame();
+
+        // depth is normalised to [0, 1], pass 1 - depth for back to front ordering.
+        // instance_data_index ends up in get_instance_indices at the draw's gl_InstanceIndex
+        void submit(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, uint32_t instance_data_index);
+
+        // sorts the submitted keys and merges them into instanced batches, scratch memory for the sort comes from resource
+        void build(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        // records every batch of a pass, must be called inside a render pass after build
+        void record(VkCommandBuffer command_buffer, uint32_t pass);
+
+        const std::vector<batch>& get_batches() const { return batches; }
+        const std::vector<uint32_t>& get_instance_indices() const { return instance_indices; }
+        const statistics& get_statistics() const { return frame_statistics; }
+    private:
+        struct sort_entry {
+            uint64_t key;
+            uint32_t instance_data_index;
+        };
+
+        struct pipeline_entry {
+            VkPipeline pipeline;
+            VkPipelineLayout pipeline_layout;
+        };
+
+        struct material_entry {
+            VkDescriptorSet descriptor_set;
+            uint32_t set_index;
+        };
+
+        class worker_pool;
+
+        static constexpr uint32_t depth_shift = 0;
+        static constexpr uint32_t mesh_shift = depth_shift + depth_bits;
+        static constexpr uint32_t material_shift = mesh_shift + mesh_bits;
+        static constexpr uint32_t pipeline_shift = material_shift + material_bits;
+        static constexpr uint32_t pass_shift = pipeline_shift + pipeline_bits;
+
+        // below this many entries the sort stays on the calling thread
+        static constexpr size_t parallel_sort_threshold = 16384;
+
+        void radix_sort(std::pmr::memory_resource* resource);
+
+        static uint32_t key_field(uint64_t key, uint32_t shift, uint32_t bits) { return static_cast<uint32_t>((key >> shift) & ((1ull << bits) - 1)); }
+
+        void count_unsorted_binds();
+
+        std::vector<pipeline_entry> pipelines;
+        std::vector<material_entry> materials;
+        std::vector<mesh> meshes;
+
+        std::vector<sort_entry> entries;
+        std::vector<sort_entry> scratch;
+        std::vector<batch> batches;
+        std::vector<uint32_t> instance_indices;
+
+        unsigned thread_count;
+        std::unique_ptr<worker_pool> workers;
+        statistics frame_statistics;
+    };
+}
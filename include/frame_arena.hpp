@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// fills memory with a pattern when it is handed out and again when it is reset, so reads of
+// uninitialised or stale frame memory show up as garbage instead of silently working
+#ifndef ENG_FRAME_ARENA_POISON
+#ifdef NDEBUG
+#define ENG_FRAME_ARENA_POISON 0
+#else
+#define ENG_FRAME_ARENA_POISON 1
+#endif
+#endif
+
+namespace eng {
+    // bump allocator for memory that only lives until the end of a frame. deallocation does nothing and
+    // reset releases everything at once, so std::pmr containers built on it stop touching the global heap
+    // as soon as the arena has grown to fit a frame
+    class frame_arena : public std::pmr::memory_resource {
+    public:
+        static constexpr unsigned char allocated_poison = 0xcd;
+        static constexpr unsigned char released_poison = 0xdd;
+
+        // used and allocation_count cover the current frame, the rest accumulate over the arena's lifetime
+        struct statistics {
+            // includes alignment padding
+            size_t used;
+            size_t high_water;
+            size_t capacity;
+            size_t block_count;
+            size_t allocation_count;
+            // blocks requested from the upstream resource since creation
+            size_t upstream_allocations;
+        };
+
+        explicit frame_arena(size_t block_size = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+        ~frame_arena() override;
+
+        frame_arena(const frame_arena&) = delete;
+        frame_arena& operator=(const frame_arena&) = delete;
+
+        // invalidates everything allocated since the last reset. a frame that spilled into more
+        // than one block gets them replaced by a single block large enough for all of it
+        void reset();
+
+        statistics get_statistics() const;
+    private:
+        struct block {
+            unsigned char* data;
+            size_t size;
+        };
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        void add_block(size_t minimum_size);
+        void release_blocks();
+
+        std::pmr::memory_resource* upstream;
+        std::vector<block> blocks;
+        size_t block_size;
+        size_t current_block;
+        size_t offset;
+        size_t used;
+        size_t high_water;
+        size_t allocation_count;
+        size_t upstream_allocations;
+    };
+
+    // gives every thread its own frame_arena so workers allocate without contention, and resets them all together
+    class frame_allocator {
+    public:
+        struct statistics {
+            size_t thread_count;
+            size_t used;
+            // sum of the per thread high water marks
+            size_t high_water;
+            size_t capacity;
+            size_t allocation_count;
+            size_t upstream_allocations;
+        };
+
+        explicit frame_allocator(size_t block_size = 64 * 1024);
+
+        frame_allocator(const frame_allocator&) = delete;
+        frame_allocator& operator=(const frame_allocator&) = delete;
+
+        // resets every thread's arena, so no thread may still be using memory from the previous frame
+        void begin_frame();
+
+        // the calling thread's arena, created on first use
+        frame_arena& get_thread_arena();
+
+        statistics get_statistics() const;
+
+        uint64_t get_frame_index() const { return frame_index; }
+    private:
+        static std::atomic<uint64_t> next_id;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::thread::id, std::unique_ptr<frame_arena>> arenas;
+        size_t block_size;
+        uint64_t id;
+        uint64_t frame_index;
+    };
+}
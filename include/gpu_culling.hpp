@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "buffer.hpp"
+#include "compute_pipeline.hpp"
+#include "depth_pyramid.hpp"
+#include "descriptor_layout.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // culls draw items against the view frustum, and optionally a depth pyramid, in a compute pass and
+    // writes the surviving VkDrawIndexedIndirectCommands on the gpu, so a whole scene is submitted with one indirect draw
+    class gpu_culling {
+    public:
+        // one entry per instance or per meshlet, laid out to match the std430 struct in cull.glsl
+        struct draw_item {
+            glm::vec4 bounding_sphere;
+            // normal cone axis in xyz and cutoff in w, a cutoff of 1 or more disables cone culling
+            glm::vec4 cone;
+            uint32_t index_count;
+            uint32_t first_index;
+            int32_t vertex_offset;
+            uint32_t instance_index;
+        };
+
+        enum class draw_path {
+            indirect_count,
+            multi_draw_indirect,
+            single_draw_indirect
+        };
+
+        // single culls against the frustum only. early and late split a frame around the depth pyramid build:
+        // early draws what was visible last frame, late tests everything against the new pyramid and
+        // draws what early missed, so objects that become unoccluded show up in the same frame
+        enum class cull_phase {
+            single,
+            early,
+            late
+        };
+
+        struct statistics {
+            uint32_t visible;
+            uint32_t frustum_culled;
+            uint32_t occlusion_culled;
+        };
+
+        static result<gpu_culling> create_gpu_culling(const device& device, uint32_t max_items,
+            const char* shader_path = ENG_SHADER_DIRECTORY "/cull.comp.spv",
+            const char* occlusion_shader_path = ENG_SHADER_DIRECTORY "/cull_occlusion.comp.spv");
+
+        static std::array<glm::vec4, 6> extract_frustum_planes(const glm::mat4& view_projection);
+
+        gpu_culling();
+        ~gpu_culling() = default;
+
+        gpu_culling(const gpu_culling&) = delete;
+        gpu_culling& operator=(const gpu_culling&) = delete;
+
+        gpu_culling(gpu_culling&& other) noexcept;
+        gpu_culling& operator=(gpu_culling&& other) noexcept;
+
+        bool valid() const { return cull_pipeline.valid(); }
+
+        // the item buffer is host visible, so this must not be called while a frame using it is in flight
+        void set_items(const std::vector<draw_item>& items);
+
+        // binds the pyramid tested by the late phase, so it must not be called while a frame using it is in flight
+        void set_depth_pyramid(const device& device, const depth_pyramid& pyramid);
+
+        // must be recorded outside of a render pass, the late phase after the depth pyramid has been built
+        void record_cull(VkCommandBuffer command_buffer, const glm::mat4& view_projection, const glm::vec3& camera_position, cull_phase phase = cull_phase::single);
+
+        // must be recorded inside a render pass with the pipeline, vertex and index buffers already bound
+        void record_draw(VkCommandBuffer command_buffer) const;
+
+        // counts from the most recent single or late phase whose submission has completed
+        statistics get_statistics() const;
+
+        uint32_t get_item_count() const { return item_count; }
+        uint32_t get_max_items() const { return max_items; }
+        draw_path get_draw_path() const { return path; }
+        const buffer& get_draw_command_buffer() const { return draw_command_buffer; }
+        const buffer& get_count_buffer() const { return count_buffer; }
+    private:
+        struct cull_parameters {
+            glm::vec4 frustum_planes[6];
+            glm::vec4 camera_position;
+            glm::mat4 view_projection;
+            glm::vec2 pyramid_size;
+            uint32_t pyramid_levels;
+            uint32_t item_count;
+            uint32_t flags;
+            uint32_t padding[3];
+        };
+
+        static constexpr uint32_t flag_compact = 1;
+        static constexpr uint32_t flag_early = 2;
+        static constexpr uint32_t flag_late = 4;
+        static constexpr uint32_t flag_statistics = 8;
+        static constexpr uint32_t flag_reversed_z = 16;
+        static constexpr uint32_t workgroup_size = 64;
+
+        // cull.glsl bindings, the parameters are the only uniform buffer
+        static constexpr uint32_t item_binding = 0;
+        static constexpr uint32_t draw_command_binding = 1;
+        static constexpr uint32_t count_binding = 2;
+        static constexpr uint32_t parameter_binding = 3;
+        static constexpr uint32_t visibility_binding = 4;
+        static constexpr uint32_t statistics_binding = 5;
+
+        descriptor_layout cull_layout;
+        descriptor_layout pyramid_layout;
+        VkDescriptorSet cull_set;
+        VkDescriptorSet pyramid_set;
+
+        compute_pipeline cull_pipeline;
+        compute_pipeline occlusion_pipeline;
+        PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count;
+
+        buffer item_buffer;
+        buffer draw_command_buffer;
+        buffer count_buffer;
+        buffer parameter_buffer;
+        buffer visibility_buffer;
+        buffer statistics_buffer;
+        buffer statistics_readback_buffer;
+
+        uint32_t max_items;
+        uint32_t item_count;
+        draw_path path;
+        bool reset_visibility;
+        bool has_depth_pyramid;
+        bool pyramid_reversed_z;
+        glm::vec2 pyramid_size;
+        uint32_t pyramid_levels;
+    };
+}
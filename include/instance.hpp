@@ -1,3 +1,5 @@
+#pragma once
+
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
@@ -12,6 +14,7 @@ namespace eng {
 
     class instance {
     public:
+        // a null window creates a headless instance without a surface
         static result<instance> create_instance(const char* application_name, GLFWwindow* window, bool debug_layers = false);
 
         instance();
@@ -28,13 +31,17 @@ namespace eng {
         VkInstance get_vulkan_instance() const { return instance_handle; }
         VkApplicationInfo get_vulkan_application_info() const { return application_info; }
         VkSurfaceKHR get_vulkan_surface() const { return surface_handle; }
+        bool is_headless() const { return surface_handle == VK_NULL_HANDLE; }
+        bool supports_physical_device_properties2() const { return physical_device_properties2; }
     private:
-        instance(VkInstance instance_handle, VkApplicationInfo application_info, VkSurfaceKHR surface);
+        instance(VkInstance instance_handle, VkApplicationInfo application_info, VkSurfaceKHR surface, bool physical_device_properties2);
 
         static bool check_validation_layer_support();
+        static bool check_instance_extension_support(const char* extension_name);
 
         VkInstance instance_handle;
         VkApplicationInfo application_info;
         VkSurfaceKHR surface_handle;
+        bool physical_device_properties2;
     };
 }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer.hpp"
+#include "compute_pipeline.hpp"
+#include "descriptor_layout.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // bins point lights into a view space grid of screen tiles and exponential depth slices every frame in compute
+    // passes, then writes one compact list of light indices per cluster, so shading only loops over the lights
+    // that can reach a pixel. the lists are read through get_shading_set() with the layout in cluster_lookup.glsl
+    class light_clusters {
+    public:
+        // laid out to match the std430 struct in cluster.glsl
+        struct light {
+            glm::vec3 position;
+            float radius;
+            glm::vec3 color;
+            float intensity;
+        };
+
+        struct statistics {
+            // entries across all cluster lists, including the ones that didn't fit
+            uint32_t light_references;
+            uint32_t non_empty_clusters;
+            uint32_t max_lights_per_cluster;
+            // references dropped because the index buffer was full
+            uint32_t overflowed_references;
+        };
+
+        // a max_light_indices of zero reserves room for an average of 64 lights per cluster
+        static result<light_clusters> create_light_clusters(const device& device, uint32_t max_lights,
+            const glm::uvec3& grid = glm::uvec3(16, 9, 24), uint32_t max_light_indices = 0,
+            const char* shader_directory = ENG_SHADER_DIRECTORY);
+
+        light_clusters();
+        ~light_clusters() = default;
+
+        light_clusters(const light_clusters&) = delete;
+        light_clusters& operator=(const light_clusters&) = delete;
+
+        light_clusters(light_clusters&& other) noexcept;
+        light_clusters& operator=(light_clusters&& other) noexcept;
+
+        bool valid() const { return count_pipeline.valid(); }
+
+        // the light buffer is host visible, so this must not be called while a frame using it is in flight
+        void set_lights(const std::vector<light>& lights);
+
+        // must be recorded on the graphics queue outside of a render pass, before the draws that read the clusters.
+        // the projection has to be a symmetric perspective, only its x and y scale are used with the near and far plane.
+        // tile rows are looked up from gl_FragCoord, top of the framebuffer first, which is ndc y = -1 with a positive height
+        // viewport whatever the sign of projection[1][1]. flipped_viewport says the draws use a negative height viewport instead
+        void record_cull(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+            float near_plane, float far_plane, uint32_t width, uint32_t height, bool flipped_viewport = false);
+
+        // counts from the most recent cull whose submission has completed
+        statistics get_statistics() const;
+
+        const glm::uvec3& get_grid() const { return grid; }
+        uint32_t get_cluster_count() const { return grid.x * grid.y * grid.z; }
+        uint32_t get_max_lights() const { return max_lights; }
+        uint32_t get_light_count() const { return light_count; }
+        uint32_t get_max_light_indices() const { return max_light_indices; }
+
+        // lights, cluster ranges, light indices and grid info at bindings 0 to 3, visible to fragment and compute shaders
+        VkDescriptorSetLayout get_shading_set_layout() const { return shading_layout.get_vulkan_descriptor_set_layout(); }
+        VkDescriptorSet get_shading_set() const { return shading_set; }
+
+        const buffer& get_light_buffer() const { return light_buffer; }
+        const buffer& get_range_buffer() const { return range_buffer; }
+        const buffer& get_index_buffer() const { return index_buffer; }
+        const buffer& get_info_buffer() const { return info_buffer; }
+    private:
+        // must match the push constant block in cluster.glsl
+        struct push_constants {
+            glm::mat4 view;
+            glm::vec4 projection;
+            glm::vec4 depth_slicing;
+            glm::uvec4 grid;
+            uint32_t max_light_indices;
+        };
+
+        // cluster_info in cluster.glsl: grid, depth slicing and screen followed by the statistics
+        static constexpr VkDeviceSize info_size = 64;
+        static constexpr VkDeviceSize statistics_offset = 48;
+
+        static constexpr uint32_t bin_workgroup_size = 64;
+
+        descriptor_layout cull_layout;
+        descriptor_layout shading_layout;
+        VkDescriptorSet cull_set;
+        VkDescriptorSet shading_set;
+
+        compute_pipeline count_pipeline;
+        compute_pipeline scan_pipeline;
+        compute_pipeline fill_pipeline;
+
+        buffer light_buffer;
+        buffer count_buffer;
+        buffer range_buffer;
+        buffer index_buffer;
+        buffer info_buffer;
+        buffer statistics_readback_buffer;
+
+        glm::uvec3 grid;
+        uint32_t max_lights;
+        uint32_t light_count;
+        uint32_t max_light_indices;
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+#include "buffer.hpp"
+#include "compute_pipeline.hpp"
+#include "descriptor_layout.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // emits, simulates, compacts and depth sorts particles entirely in compute passes, the alive count only
+    // ever lives on the gpu and the draw is sized with an indirect command, so nothing is read back.
+    // record_update works on the graphics queue or on device::get_vulkan_compute_queue(), all buffers are shared
+    // between both families so the async path only needs a semaphore before the draw
+    class particle_system {
+    public:
+        // laid out to match the std430 struct in particle.glsl
+        struct particle {
+            // xyz position, w remaining life in seconds
+            glm::vec4 position;
+            // xyz velocity, w total lifetime
+            glm::vec4 velocity;
+        };
+
+        struct emitter {
+            glm::vec3 position = glm::vec3(0.0f);
+            float radius = 0.0f;
+            glm::vec3 velocity = glm::vec3(0.0f);
+            // each velocity component gets a random offset in [-spread, spread]
+            float spread = 1.0f;
+            glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+            float drag = 0.0f;
+            // particles per second, fractions carry over to the next update
+            float emit_rate = 0.0f;
+            float lifetime_min = 1.0f;
+            float lifetime_max = 2.0f;
+        };
+
+        // capacity is also bounded by maxComputeWorkGroupCount, about 16 million particles at the guaranteed minimum
+        static result<particle_system> create_particle_system(const device& device, uint32_t capacity,
+            const char* shader_directory = ENG_SHADER_DIRECTORY);
+
+        particle_system();
+        ~particle_system() = default;
+
+        particle_system(const particle_system&) = delete;
+        particle_system& operator=(const particle_system&) = delete;
+
+        particle_system(particle_system&& other) noexcept;
+        particle_system& operator=(particle_system&& other) noexcept;
+
+        bool valid() const { return emit_pipeline.valid(); }
+
+        void set_emitter(const emitter& settings) { current_emitter = settings; }
+        const emitter& get_emitter() const { return current_emitter; }
+
+        // sorting back to front is only needed for blended particles, it's the most expensive pass
+        void set_sorting(bool enabled) { sorting = enabled; }
+        bool get_sorting() const { return sorting; }
+
+        // queues a one off burst on top of the emit rate, it's clamped to the free capacity on the gpu
+        void emit(uint32_t count) { burst_count += count; }
+
+        // must be recorded outside of a render pass. the previous update's draw has to be complete, or waited on
+        // with a semaphore when the update goes to the async compute queue, since the particle lists swap roles
+        void record_update(VkCommandBuffer command_buffer, float delta_time, const glm::vec3& camera_position, const glm::vec3& camera_forward);
+
+        // makes the update visible to the vertex shader and indirect draw when both are recorded on the graphics queue
+        static void record_draw_barrier(VkCommandBuffer command_buffer);
+
+        // draws six vertices per alive particle, the bound pipeline reads get_particle_buffer() and, when sorting,
+        // the particle index from the y component of get_sort_buffer() entries
+        void record_draw(VkCommandBuffer command_buffer) const;
+
+        uint32_t get_capacity() const { return capacity; }
+        uint32_t get_sort_capacity() const { return sort_capacity; }
+
+        // the list written by the most recent update
+        const buffer& get_particle_buffer() const { return particle_buffers[parity]; }
+        const buffer& get_sort_buffer() const { return sort_buffer; }
+
+        // alive_count is the first uint, valid after the update completes
+        const buffer& get_counter_buffer() const { return counter_buffer; }
+        const buffer& get_argument_buffer() const { return argument_buffer; }
+    private:
+        // must match the push constant block in particle.glsl
+        struct push_constants {
+            glm::vec4 emitter_position;
+            glm::vec4 emitter_velocity;
+            glm::vec4 gravity;
+            glm::vec4 camera_position;
+            glm::vec4 camera_forward;
+            float delta_time;
+            float lifetime_min;
+            float lifetime_max;
+            uint32_t seed;
+            uint32_t requested_emit;
+            uint32_t capacity;
+            uint32_t sort_k;
+            uint32_t sort_j;
+        };
+
+        // offsets into the argument buffer in bytes, see particle.glsl
+        static constexpr VkDeviceSize emit_arguments_offset = 0;
+        static constexpr VkDeviceSize simulate_arguments_offset = 12;
+        static constexpr VkDeviceSize sort_arguments_offset = 24;
+        static constexpr VkDeviceSize draw_arguments_offset = 36;
+
+        static constexpr uint32_t simulate_group_size = 256;
+        static constexpr uint32_t sort_block_size = 1024;
+
+        descriptor_layout layout;
+        VkDescriptorSet descriptor_sets[2];
+
+        compute_pipeline begin_arguments_pipeline;
+        compute_pipeline end_arguments_pipeline;
+        compute_pipeline emit_pipeline;
+        compute_pipeline simulate_pipeline;
+        compute_pipeline sort_local_pipeline;
+        compute_pipeline sort_step_pipeline;
+        compute_pipeline sort_merge_pipeline;
+
+        buffer particle_buffers[2];
+        buffer counter_buffer;
+        buffer sort_buffer;
+        buffer argument_buffer;
+
+        emitter current_emitter;
+        uint32_t capacity;
+        uint32_t sort_capacity;
+        uint32_t parity;
+        uint32_t frame_index;
+        uint32_t burst_count;
+        float emit_accumulator;
+        bool sorting;
+        bool counters_cleared;
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "capture.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // re-executes a file written by capture, one submission per captured frame on the graphics queue,
+    // which accepts every command a capture can contain. works on a headless device
+    class replayer {
+    public:
+        enum class pacing {
+            // submits the next frame as soon as the previous one has finished
+            unlimited,
+            // waits so frames start at the same intervals they were captured at
+            recorded
+        };
+
+        struct frame_timing {
+            // creating the frame's objects, recording and submitting, without waiting for the gpu
+            double cpu_milliseconds;
+            // between timestamps around the frame's commands, zero when the queue has no timestamp support
+            double gpu_milliseconds;
+            // time between this frame's end and the previous one's while capturing
+            double recorded_milliseconds;
+            uint32_t commands;
+        };
+
+        static result<replayer> create_replayer(const device& device, const char* path);
+
+        replayer();
+        ~replayer();
+
+        replayer(const replayer&) = delete;
+        replayer& operator=(const replayer&) = delete;
+
+        replayer(replayer&& other) noexcept;
+        replayer& operator=(replayer&& other) noexcept;
+
+        bool valid() const { return command_buffer_handle != VK_NULL_HANDLE; }
+
+        // recreates every captured object, runs all frames and releases the objects again, so it can be
+        // called repeatedly. commands recorded after the last end_frame are not replayed
+        result<std::vector<frame_timing>> run(const device& device, pacing mode);
+
+        const std::string& get_captured_device_name() const { return captured_device_name; }
+        uint32_t get_frame_count() const { return frame_count; }
+        bool has_gpu_timing() const { return timestamp_valid; }
+
+        // commands from the last run that used objects the capture had no record of or sets holding image descriptors,
+        // and dispatches or push constants whose pipeline or descriptor set bind was skipped
+        uint64_t get_skipped_commands() const { return skipped_commands; }
+
+        // draws and image commands the replayed frames of the last run contained, which the capture only counted
+        uint64_t get_unreplayable_commands(capture::unreplayable_kind kind) const { return unreplayable_commands[static_cast<uint32_t>(kind)]; }
+    private:
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkCommandPool command_pool_handle;
+        VkCommandBuffer command_buffer_handle;
+        VkFence fence_handle;
+        VkQueryPool query_pool_handle;
+
+        std::vector<uint8_t> data;
+        size_t records_offset;
+        std::string captured_device_name;
+        uint32_t frame_count;
+        bool timestamp_valid;
+        // only the queue's valid bits count, differences are taken modulo them so a wrap stays small
+        uint64_t timestamp_mask;
+        float timestamp_period;
+        uint64_t skipped_commands;
+        std::array<uint64_t, capture::unreplayable_kind_count> unreplayable_commands;
+    };
+}
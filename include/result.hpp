@@ -1,3 +1,5 @@
+#pragma once
+
 #include <utility>
 #include <stdexcept>
 
@@ -71,10 +73,10 @@ namespace eng {
         }
 
         bool is_success() const {
-            return success;
+            return successful;
         }
         bool is_error() const {
-            return !success;
+            return !successful;
         }
 
         const T& unwrap() const {
@@ -114,4 +116,4 @@ namespace eng {
         };
         const char* message;
     };
-}
\ No newline at end of file
+}
\ No newline at end of file
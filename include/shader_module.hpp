@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "device.hpp"
+
+#ifndef ENG_SHADER_DIRECTORY
+#define ENG_SHADER_DIRECTORY "shaders"
+#endif
+
+namespace eng {
+    class shader_module {
+    public:
+        static result<shader_module> create_shader_module(const device& device, const std::vector<uint32_t>& code);
+        static result<shader_module> create_shader_module(const device& device, const char* path);
+
+        static result<std::vector<uint32_t>> read_shader_file(const char* path);
+
+        shader_module();
+        ~shader_module();
+
+        shader_module(const shader_module&) = delete;
+        shader_module& operator=(const shader_module&) = delete;
+
+        shader_module(shader_module&& other) noexcept;
+        shader_module& operator=(shader_module&& other) noexcept;
+
+        bool valid() const { return shader_module_handle != VK_NULL_HANDLE; }
+
+        VkShaderModule get_vulkan_shader_module() const { return shader_module_handle; }
+    private:
+        shader_module(VkDevice logical_device_handle, VkShaderModule shader_module_handle);
+
+        VkDevice logical_device_handle;
+        VkShaderModule shader_module_handle;
+    };
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "buffer.hpp"
+#include "device.hpp"
+
+namespace eng {
+    // keeps textures partially resident: the coarse mip tail of every texture is loaded first, finer mips are
+    // loaded on worker threads in order of screen space priority and the least needed mips are evicted
+    // whenever the device local heap would go over its budget
+    class texture_streamer {
+    public:
+        using texture_id = uint32_t;
+
+        static constexpr texture_id invalid_texture = UINT32_MAX;
+
+        struct texture_description {
+            uint32_t width;
+            uint32_t height;
+            uint32_t mip_count;
+            VkFormat format;
+            // 4 and 8 or 16 for block compressed formats, 1 and the texel size otherwise
+            uint32_t block_extent = 1;
+            uint32_t block_size = 4;
+            // called on a worker thread, fills data with the tightly packed blocks of one mip and returns false on failure
+            std::function<bool(uint32_t mip, std::vector<uint8_t>& data)> load_mip;
+        };
+
+        struct settings {
+            uint32_t worker_count = 2;
+            // split evenly between the frames in flight, no single mip larger than one share is ever streamed in
+            VkDeviceSize staging_size = 64 * 1024 * 1024;
+            // fraction of the heap budget the streamer lets the heap's total usage reach
+            float budget_fraction = 0.9f;
+            // mips no larger than this along either axis are loaded together when a texture is added and never evicted
+            uint32_t tail_size = 64;
+            uint32_t frames_in_flight = 2;
+        };
+
+        struct heap_statistics {
+            VkDeviceSize size;
+            VkDeviceSize budget;
+            VkDeviceSize usage;
+            VkDeviceSize streamer_resident;
+            bool device_local;
+        };
+
+        struct statistics {
+            std::vector<heap_statistics> heaps;
+            uint32_t texture_count;
+            // textures whose desired mip is resident
+            uint32_t textures_complete;
+            uint32_t pending_loads;
+            VkDeviceSize uploaded_bytes;
+            uint32_t uploaded_mips;
+            uint32_t evicted_mips;
+            uint32_t dropped_loads;
+            uint32_t failed_loads;
+        };
+
+        static result<texture_streamer> create_texture_streamer(const device& device);
+        static result<texture_streamer> create_texture_streamer(const device& device, const settings& settings);
+
+        texture_streamer();
+        ~texture_streamer();
+
+        texture_streamer(const texture_streamer&) = delete;
+        texture_streamer& operator=(const texture_streamer&) = delete;
+
+        texture_streamer(texture_streamer&& other) noexcept;
+        texture_streamer& operator=(texture_streamer&& other) noexcept;
+
+        bool valid() const { return shared != nullptr; }
+
+        // queues the mip tail for loading, the texture has no image view until a later update uploads it
+        texture_id add_texture(texture_description description);
+
+        // the image is released frames_in_flight updates later, so views handed out stay valid until then
+        void remove_texture(texture_id id);
+
+        // projected size of the texture on screen in pixels along its larger axis, zero keeps only the mip tail resident
+        void set_screen_size(texture_id id, float pixels);
+
+        // must be called once per frame outside of a render pass, after the command buffer recorded
+        // frames_in_flight updates ago has finished executing. records the batched staging copies and
+        // residency changes, replaced images are released frames_in_flight updates later. temporary lists
+        // are allocated from resource, which only has to outlive the call
+        void update(const device& device, VkCommandBuffer command_buffer, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        // level 0 of the view is the finest resident mip, so samplers need no lod bias
+        VkImageView get_image_view(texture_id id) const;
+
+        uint32_t get_resident_mip(texture_id id) const;
+
+        // textures whose image view was replaced by the last update and need their descriptors rewritten
+        const std::vector<texture_id>& get_changed_textures() const { return changed_textures; }
+
+        // heap figures are from the last update, counters are totals since creation
+        statistics get_statistics() const;
+    private:
+        struct load_request {
+            texture_id id;
+            uint32_t generation;
+            uint32_t first_mip;
+            uint32_t mip_count;
+            float priority;
+            std::shared_ptr<const texture_description> description;
+
+            bool operator<(const load_request& other) const { return priority < other.priority; }
+        };
+
+        struct load_result {
+            texture_id id;
+            uint32_t generation;
+            uint32_t first_mip;
+            uint32_t mip_count;
+            float priority;
+            bool succeeded;
+            // offsets of each mip in data, aligned for buffer to image copies
+            std::vector<VkDeviceSize> mip_offsets;
+            std::vector<uint8_t> data;
+        };
+
+        // lives on the heap so worker threads keep a stable pointer when the streamer is moved
+        struct shared_state {
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::priority_queue<load_request> requests;
+            std::vector<load_result> results;
+            bool stopping = false;
+            std::vector<std::thread> workers;
+        };
+
+        struct image_allocation {
+            VkImage image_handle;
+            VkDeviceMemory memory_handle;
+            VkImageView image_view_handle;
+            VkDeviceSize memory_size;
+            uint32_t heap_index;
+        };
+
+        struct texture {
+            std::shared_ptr<const texture_description> description;
+            image_allocation image;
+            // equal to the mip count while nothing is resident
+            uint32_t resident_mip;
+            uint32_t target_mip;
+            uint32_t tail_mip;
+            // finest mip that fits in one frame's share of the staging buffer and has not failed to load
+            uint32_t min_mip;
+            uint32_t generation;
+            float screen_size;
+            bool load_in_flight;
+            bool staged;
+            bool active;
+        };
+
+        struct staged_upload {
+            texture_id id;
+            uint32_t first_mip;
+            uint32_t mip_count;
+            VkDeviceSize staging_offset;
+            std::vector<VkDeviceSize> mip_offsets;
+        };
+
+        static void worker_main(shared_state* state);
+        static VkDeviceSize mip_bytes(const texture_description& description, uint32_t mip);
+        static VkDeviceSize copy_alignment(const texture_description& description);
+        static uint32_t mip_dimension(const texture_description& description, uint32_t mip);
+        static VkExtent3D mip_extent(const texture_description& description, uint32_t mip);
+
+        float priority(const texture& texture, uint32_t mip) const;
+        uint32_t desired_mip(const texture& texture) const;
+        VkDeviceSize retired_bytes(uint32_t heap_index) const;
+        bool evict(VkDeviceSize needed, float below_priority, VkDeviceSize& planned, VkDeviceSize limit);
+        void stage(load_result& result);
+        void apply_residency(const device& device, VkCommandBuffer command_buffer, std::pmr::memory_resource* resource);
+        result<image_allocation> create_image(const device& device, const texture_description& description, uint32_t first_mip) const;
+        void retire(texture& texture);
+        void destroy_image(image_allocation& image) const;
+        void destroy();
+
+        VkDevice logical_device_handle;
+        VkPhysicalDeviceMemoryProperties memory_properties;
+        uint32_t streaming_heap;
+        settings configuration;
+
+        buffer staging_buffer;
+        VkDeviceSize staging_region_size;
+        VkDeviceSize staging_offset;
+        uint32_t frame_slot;
+
+        std::unique_ptr<shared_state> shared;
+        std::vector<texture> textures;
+        std::vector<texture_id> free_ids;
+        std::vector<load_result> pending_results;
+        std::vector<staged_upload> staged_uploads;
+        std::vector<std::vector<image_allocation>> retired_images;
+        std::vector<texture_id> changed_textures;
+
+        std::vector<device::heap_budget> heap_budgets;
+        std::vector<VkDeviceSize> heap_resident;
+        VkDeviceSize uploaded_bytes;
+        uint32_t uploaded_mips;
+        uint32_t evicted_mips;
+        uint32_t dropped_loads;
+        uint32_t failed_loads;
+    };
+}
@@ -0,0 +1,56 @@
+// layouts shared by the light binning shaders, they must match eng::light_clusters
+
+struct light {
+    // xyz world position, w radius
+    vec4 position_radius;
+    // rgb color, a intensity
+    vec4 color_intensity;
+};
+
+// grid: cluster counts in x, y and z then the light count
+// depth_slicing: slice = log(depth) * x + y, then the near and far plane
+// screen: framebuffer size then the size of a tile in pixels
+// statistics: light references, non empty clusters, most lights in one cluster, references that didn't fit
+struct cluster_info {
+    uvec4 grid;
+    vec4 depth_slicing;
+    vec4 screen;
+    uvec4 statistics;
+};
+
+layout(set = 0, binding = 0, std430) readonly buffer light_buffer {
+    light lights[];
+};
+
+// per cluster light count while binning, reused as the fill cursor after the scan
+layout(set = 0, binding = 1, std430) buffer count_buffer {
+    uint cluster_counts[];
+};
+
+// x is the first entry in light_indices, y the number of lights
+layout(set = 0, binding = 2, std430) buffer range_buffer {
+    uvec2 cluster_ranges[];
+};
+
+layout(set = 0, binding = 3, std430) buffer index_buffer {
+    uint light_indices[];
+};
+
+layout(set = 0, binding = 4, std430) buffer info_buffer {
+    cluster_info info;
+};
+
+layout(push_constant) uniform constants {
+    mat4 view;
+    // x and y scale of the projection, then the near and far plane
+    vec4 projection;
+    // slice scale and bias, then the framebuffer size
+    vec4 depth_slicing;
+    // cluster counts in x, y and z then the light count
+    uvec4 grid;
+    uint max_light_indices;
+};
+
+uint cluster_index(uint x, uint y, uint z) {
+    return (z * grid.y + y) * grid.x + x;
+}
@@ -0,0 +1,50 @@
+// reads the lists written by eng::light_clusters through its shading set, define CLUSTER_SET before including
+// to bind it somewhere other than set 1. usage:
+//     uvec2 range = cluster_light_range(gl_FragCoord.xy, view_depth);
+//     for (uint i = 0u; i < range.y; ++i) { cluster_light light = cluster_light_at(range.x + i); ... }
+
+#ifndef CLUSTER_SET
+#define CLUSTER_SET 1
+#endif
+
+struct cluster_light {
+    // xyz world position, w radius
+    vec4 position_radius;
+    // rgb color, a intensity
+    vec4 color_intensity;
+};
+
+layout(set = CLUSTER_SET, binding = 0, std430) readonly buffer cluster_light_buffer {
+    cluster_light cluster_lights[];
+};
+
+// x is the first entry in cluster_light_indices, y the number of lights
+layout(set = CLUSTER_SET, binding = 1, std430) readonly buffer cluster_range_buffer {
+    uvec2 cluster_light_ranges[];
+};
+
+layout(set = CLUSTER_SET, binding = 2, std430) readonly buffer cluster_index_buffer {
+    uint cluster_light_indices[];
+};
+
+// see cluster_info in cluster.glsl
+layout(set = CLUSTER_SET, binding = 3, std430) readonly buffer cluster_info_buffer {
+    uvec4 cluster_grid;
+    vec4 cluster_depth_slicing;
+    vec4 cluster_screen;
+    uvec4 cluster_statistics;
+};
+
+// view_depth is the positive distance along the view direction, the same one the lights were binned with.
+// tile rows count from gl_FragCoord.y = 0, record_cull's flipped_viewport has to match the viewport the draw uses
+uvec2 cluster_light_range(vec2 frag_coord, float view_depth) {
+    uvec2 tile = min(uvec2(frag_coord / cluster_screen.zw), cluster_grid.xy - 1u);
+    float depth = clamp(view_depth, cluster_depth_slicing.z, cluster_depth_slicing.w);
+    uint slice = uint(clamp(floor(log(depth) * cluster_depth_slicing.x + cluster_depth_slicing.y), 0.0, float(cluster_grid.z - 1u)));
+
+    return cluster_light_ranges[(slice * cluster_grid.y + tile.y) * cluster_grid.x + tile.x];
+}
+
+cluster_light cluster_light_at(uint list_entry) {
+    return cluster_lights[cluster_light_indices[list_entry]];
+}
@@ -0,0 +1,208 @@
+layout(local_size_x = 64) in;
+
+struct draw_item {
+    vec4 bounding_sphere;
+    vec4 cone;
+    uint index_count;
+    uint first_index;
+    int vertex_offset;
+    uint instance_index;
+};
+
+struct draw_command {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(set = 0, binding = 0, std430) readonly buffer item_buffer {
+    draw_item items[];
+};
+
+layout(set = 0, binding = 1, std430) writeonly buffer command_buffer {
+    draw_command commands[];
+};
+
+layout(set = 0, binding = 2, std430) buffer count_buffer {
+    uint draw_count;
+};
+
+layout(set = 0, binding = 3, std140) uniform parameter_buffer {
+    vec4 frustum_planes[6];
+    vec4 camera_position;
+    mat4 view_projection;
+    vec2 pyramid_size;
+    uint pyramid_levels;
+    uint item_count;
+    uint flags;
+} parameters;
+
+layout(set = 0, binding = 4, std430) buffer visibility_buffer {
+    uint visibility[];
+};
+
+layout(set = 0, binding = 5, std430) buffer statistics_buffer {
+    uint visible_count;
+    uint frustum_culled_count;
+    uint occlusion_culled_count;
+};
+
+#ifdef OCCLUSION_CULLING
+layout(set = 1, binding = 0) uniform sampler2D depth_pyramid;
+#endif
+
+const uint flag_compact = 1u;
+const uint flag_early = 2u;
+const uint flag_late = 4u;
+const uint flag_statistics = 8u;
+const uint flag_reversed_z = 16u;
+
+bool frustum_visible(vec4 sphere) {
+    for (int i = 0; i < 6; ++i) {
+        if (dot(parameters.frustum_planes[i].xyz, sphere.xyz) + parameters.frustum_planes[i].w < -sphere.w) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// a cone cutoff of 1 or more disables the test, which is what whole instances use
+bool cone_visible(vec4 sphere, vec4 cone) {
+    if (cone.w >= 1.0) {
+        return true;
+    }
+
+    vec3 to_center = sphere.xyz - parameters.camera_position.xyz;
+
+    return dot(to_center, cone.xyz) < cone.w * length(to_center) + sphere.w;
+}
+
+#ifdef OCCLUSION_CULLING
+// projects the sphere's bounding box and compares its nearest depth against the farthest
+// occluder depth in a pyramid level where the box covers at most 2x2 texels
+bool occlusion_visible(vec4 sphere) {
+    bool reversed_z = (parameters.flags & flag_reversed_z) != 0u;
+
+    vec3 box_min = sphere.xyz - vec3(sphere.w);
+    vec3 box_max = sphere.xyz + vec3(sphere.w);
+
+    vec2 uv_min = vec2(1.0);
+    vec2 uv_max = vec2(0.0);
+    float nearest_depth = reversed_z ? 0.0 : 1.0;
+
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = vec3(
+            (i & 1) != 0 ? box_max.x : box_min.x,
+            (i & 2) != 0 ? box_max.y : box_min.y,
+            (i & 4) != 0 ? box_max.z : box_min.z);
+
+        vec4 clip = parameters.view_projection * vec4(corner, 1.0);
+
+        // the box crosses the camera plane, so it can't be tested reliably
+        if (clip.w <= 0.0) {
+            return true;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        nearest_depth = reversed_z ? max(nearest_depth, ndc.z) : min(nearest_depth, ndc.z);
+    }
+
+    uv_min = clamp(uv_min, vec2(0.0), vec2(1.0));
+    uv_max = clamp(uv_max, vec2(0.0), vec2(1.0));
+
+    // levels halve with floor and fold odd trailing rows and columns into their last texel, so level texel t
+    // covers base texels t << level up to (t + 1) << level, and the last one also covers the remainder.
+    // mapping through base texels keeps the fetched texels on the box's footprint at any size
+    ivec2 base_size = ivec2(parameters.pyramid_size);
+    ivec2 base_min = min(ivec2(uv_min * parameters.pyramid_size), base_size - 1);
+    ivec2 base_max = min(ivec2(uv_max * parameters.pyramid_size), base_size - 1);
+
+    // with 2^level texels per step the footprint spans at most two texels per axis
+    ivec2 extent = base_max - base_min;
+    int level = int(ceil(log2(max(float(max(extent.x, extent.y)), 1.0))));
+    level = min(level, int(parameters.pyramid_levels) - 1);
+
+    ivec2 level_size = textureSize(depth_pyramid, level);
+    ivec2 texel_min = min(base_min >> level, level_size - 1);
+    ivec2 texel_max = min(base_max >> level, level_size - 1);
+
+    float depth_a = texelFetch(depth_pyramid, texel_min, level).r;
+    float depth_b = texelFetch(depth_pyramid, ivec2(texel_max.x, texel_min.y), level).r;
+    float depth_c = texelFetch(depth_pyramid, ivec2(texel_min.x, texel_max.y), level).r;
+    float depth_d = texelFetch(depth_pyramid, texel_max, level).r;
+
+    if (reversed_z) {
+        float farthest_depth = min(min(depth_a, depth_b), min(depth_c, depth_d));
+
+        return nearest_depth >= farthest_depth;
+    }
+
+    float farthest_depth = max(max(depth_a, depth_b), max(depth_c, depth_d));
+
+    return nearest_depth <= farthest_depth;
+}
+#endif
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+
+    if (index >= parameters.item_count) {
+        return;
+    }
+
+    draw_item item = items[index];
+
+    bool in_frustum = frustum_visible(item.bounding_sphere) && cone_visible(item.bounding_sphere, item.cone);
+    bool visible = in_frustum;
+    bool draw = in_frustum;
+
+    // the early phase redraws what was visible last frame, the late phase tests everything
+    // against the fresh pyramid and only draws what the early phase did not
+    if ((parameters.flags & flag_early) != 0u) {
+        draw = in_frustum && visibility[index] != 0u;
+    }
+
+#ifdef OCCLUSION_CULLING
+    if ((parameters.flags & flag_late) != 0u) {
+        visible = in_frustum && occlusion_visible(item.bounding_sphere);
+        draw = visible && visibility[index] == 0u;
+
+        visibility[index] = visible ? 1u : 0u;
+    }
+#endif
+
+    if ((parameters.flags & flag_statistics) != 0u) {
+        if (visible) {
+            atomicAdd(visible_count, 1u);
+        }
+        else if (!in_frustum) {
+            atomicAdd(frustum_culled_count, 1u);
+        }
+        else {
+            atomicAdd(occlusion_culled_count, 1u);
+        }
+    }
+
+    draw_command command;
+    command.index_count = item.index_count;
+    command.instance_count = draw ? 1u : 0u;
+    command.first_index = item.first_index;
+    command.vertex_offset = item.vertex_offset;
+    command.first_instance = item.instance_index;
+
+    if ((parameters.flags & flag_compact) != 0u) {
+        if (draw) {
+            commands[atomicAdd(draw_count, 1u)] = command;
+        }
+    }
+    else {
+        commands[index] = command;
+    }
+}
@@ -0,0 +1,79 @@
+// layouts shared by the particle compute shaders, they must match eng::particle_system
+
+struct particle {
+    // xyz position, w remaining life in seconds
+    vec4 position;
+    // xyz velocity, w total lifetime
+    vec4 velocity;
+};
+
+// the two particle lists swap roles every update, emit appends to the source list
+// and simulate compacts the survivors into the destination list
+layout(set = 0, binding = 0, std430) buffer source_buffer {
+    particle source_particles[];
+};
+
+layout(set = 0, binding = 1, std430) buffer destination_buffer {
+    particle destination_particles[];
+};
+
+layout(set = 0, binding = 2, std430) buffer counter_buffer {
+    uint alive_count;
+    uint emit_count;
+    uint first_emit;
+    uint next_count;
+    uint sort_count;
+};
+
+// x is the sort key, y the particle index
+layout(set = 0, binding = 3, std430) buffer sort_buffer {
+    uvec2 sort_entries[];
+};
+
+layout(set = 0, binding = 4, std430) buffer argument_buffer {
+    uint arguments[];
+};
+
+layout(push_constant) uniform constants {
+    // xyz position, w spawn radius
+    vec4 emitter_position;
+    // xyz initial velocity, w random spread added to it
+    vec4 emitter_velocity;
+    // xyz gravity, w drag
+    vec4 gravity;
+    vec4 camera_position;
+    vec4 camera_forward;
+    float delta_time;
+    float lifetime_min;
+    float lifetime_max;
+    uint seed;
+    uint requested_emit;
+    uint capacity;
+    uint sort_k;
+    uint sort_j;
+};
+
+// offsets into the argument buffer in uints
+const uint emit_arguments = 0u;
+const uint simulate_arguments = 3u;
+const uint sort_arguments = 6u;
+const uint draw_arguments = 9u;
+
+const uint simulate_group_size = 256u;
+const uint sort_block_size = 1024u;
+
+uint hash(uint value) {
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+
+    return value;
+}
+
+float random(inout uint state) {
+    state = hash(state);
+
+    return float(state) * (1.0 / 4294967296.0);
+}
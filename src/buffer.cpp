@@ -0,0 +1,154 @@
+#include "../include/buffer.hpp"
+#include "../include/capture.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+eng::result<eng::buffer> eng::buffer::create_buffer(const eng::device& device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool concurrent) {
+    if (!device.valid()) {
+        return eng::result<eng::buffer>::error("Invalid device.");
+    }
+
+    if (size == 0) {
+        return eng::result<eng::buffer>::error("Buffer size must be greater than zero.");
+    }
+
+    VkDevice logical_device = device.get_vulkan_logical_device();
+
+    VkBufferCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    create_info.size = size;
+    create_info.usage = usage;
+    create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    uint32_t queue_families[] = { device.get_graphics_queue_family(), device.get_compute_queue_family() };
+
+    if (concurrent && device.has_async_compute()) {
+        create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        create_info.queueFamilyIndexCount = 2;
+        create_info.pQueueFamilyIndices = queue_families;
+    }
+
+    VkBuffer buffer_handle;
+    if (vkCreateBuffer(logical_device, &create_info, nullptr, &buffer_handle) != VK_SUCCESS) {
+        return eng::result<eng::buffer>::error("Failed to create buffer.");
+    }
+
+    VkMemoryRequirements memory_requirements;
+    vkGetBufferMemoryRequirements(logical_device, buffer_handle, &memory_requirements);
+
+    eng::result<uint32_t> memory_type_result = device.find_memory_type(memory_requirements.memoryTypeBits, properties);
+
+    if (memory_type_result.is_error()) {
+        vkDestroyBuffer(logical_device, buffer_handle, nullptr);
+
+        return eng::result<eng::buffer>::error(memory_type_result.error_message());
+    }
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = memory_requirements.size;
+    allocate_info.memoryTypeIndex = memory_type_result.unwrap();
+
+    VkDeviceMemory memory_handle;
+    if (vkAllocateMemory(logical_device, &allocate_info, nullptr, &memory_handle) != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, buffer_handle, nullptr);
+
+        return eng::result<eng::buffer>::error("Failed to allocate buffer memory.");
+    }
+
+    vkBindBufferMemory(logical_device, buffer_handle, memory_handle, 0);
+
+    void* mapped_data = nullptr;
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(logical_device, memory_handle, 0, size, 0, &mapped_data) != VK_SUCCESS) {
+            vkFreeMemory(logical_device, memory_handle, nullptr);
+            vkDestroyBuffer(logical_device, buffer_handle, nullptr);
+
+            return eng::result<eng::buffer>::error("Failed to map buffer memory.");
+        }
+    }
+
+    eng::capture::record_create_buffer(buffer_handle, size, usage, properties, concurrent);
+
+    return eng::result<eng::buffer>::success(buffer(logical_device, buffer_handle, memory_handle, size, mapped_data));
+}
+
+eng::buffer::buffer()
+    : logical_device_handle(VK_NULL_HANDLE),
+    buffer_handle(VK_NULL_HANDLE),
+    memory_handle(VK_NULL_HANDLE),
+    size(0),
+    mapped_data(nullptr) {}
+
+eng::buffer::buffer(VkDevice logical_device_handle, VkBuffer buffer_handle, VkDeviceMemory memory_handle, VkDeviceSize size, void* mapped_data)
+    : logical_device_handle(logical_device_handle),
+    buffer_handle(buffer_handle),
+    memory_handle(memory_handle),
+    size(size),
+    mapped_data(mapped_data) {}
+
+eng::buffer::~buffer() {
+    destroy();
+}
+
+eng::buffer::buffer(eng::buffer&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    buffer_handle(std::exchange(other.buffer_handle, VK_NULL_HANDLE)),
+    memory_handle(std::exchange(other.memory_handle, VK_NULL_HANDLE)),
+    size(std::exchange(other.size, 0)),
+    mapped_data(std::exchange(other.mapped_data, nullptr)) {}
+
+eng::buffer& eng::buffer::operator=(eng::buffer&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        buffer_handle = std::exchange(other.buffer_handle, VK_NULL_HANDLE);
+        memory_handle = std::exchange(other.memory_handle, VK_NULL_HANDLE);
+        size = std::exchange(other.size, 0);
+        mapped_data = std::exchange(other.mapped_data, nullptr);
+    }
+
+    return *this;
+}
+
+void eng::buffer::write(const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    if (mapped_data == nullptr) {
+        throw std::logic_error("Called write on a buffer that is not host visible.");
+    }
+
+    if (offset + size > this->size) {
+        throw std::out_of_range("Buffer write out of range.");
+    }
+
+    memcpy(static_cast<char*>(mapped_data) + offset, data, static_cast<size_t>(size));
+
+    eng::capture::record_write_buffer(buffer_handle, data, size, offset);
+}
+
+void eng::buffer::destroy() {
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (mapped_data != nullptr) {
+        vkUnmapMemory(logical_device_handle, memory_handle);
+        mapped_data = nullptr;
+    }
+
+    if (buffer_handle != VK_NULL_HANDLE) {
+        eng::capture::record_destroy_buffer(buffer_handle);
+        vkDestroyBuffer(logical_device_handle, buffer_handle, nullptr);
+    }
+
+    if (memory_handle != VK_NULL_HANDLE) {
+        vkFreeMemory(logical_device_handle, memory_handle, nullptr);
+    }
+
+    buffer_handle = VK_NULL_HANDLE;
+    memory_handle = VK_NULL_HANDLE;
+    logical_device_handle = VK_NULL_HANDLE;
+}
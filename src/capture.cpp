@@ -0,0 +1,562 @@
+#include "../include/capture.hpp"
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+std::shared_ptr<eng::capture::capture_state> eng::capture::active_state;
+std::atomic<bool> eng::capture::capturing{ false };
+
+namespace {
+    // non dispatchable handles are pointers on 64 bit platforms and integers on 32 bit ones
+    template <typename T>
+    uint64_t handle_value(T handle) {
+        if constexpr (std::is_pointer_v<T>) {
+            return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+        }
+        else {
+            return static_cast<uint64_t>(handle);
+        }
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& payload, const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "capture payloads are written as raw bytes");
+
+        size_t offset = payload.size();
+        payload.resize(offset + sizeof(T));
+        std::memcpy(payload.data() + offset, &value, sizeof(T));
+    }
+
+    void append_bytes(std::vector<uint8_t>& payload, const void* data, size_t size) {
+        size_t offset = payload.size();
+        payload.resize(offset + size);
+
+        if (size > 0) {
+            std::memcpy(payload.data() + offset, data, size);
+        }
+    }
+
+    uint64_t hash_code(const std::vector<uint32_t>& code) {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (uint32_t word : code) {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+
+        return hash ^ code.size();
+    }
+}
+
+eng::result<eng::capture> eng::capture::create_capture(const eng::device& device, const char* path) {
+    if (!device.valid()) {
+        return eng::result<eng::capture>::error("Invalid device.");
+    }
+
+    if (path == nullptr) {
+        return eng::result<eng::capture>::error("Invalid capture path.");
+    }
+
+    eng::capture capture;
+    capture.shared = std::make_shared<capture_state>();
+
+    capture_state& state = *capture.shared;
+    state.file.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!state.file.is_open()) {
+        return eng::result<eng::capture>::error("Failed to open capture file.");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    char device_name[device_name_size]{};
+    std::strncpy(device_name, properties.deviceName, device_name_size - 1);
+
+    uint32_t version = format_version;
+    state.file.write(magic, sizeof(magic));
+    state.file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    state.file.write(device_name, sizeof(device_name));
+
+    state.start_time = std::chrono::steady_clock::now();
+    state.next_id = 1;
+    state.stats = {};
+    state.stats.bytes = sizeof(magic) + sizeof(version) + sizeof(device_name);
+
+    std::shared_ptr<capture_state> expected;
+
+    if (!std::atomic_compare_exchange_strong(&active_state, &expected, capture.shared)) {
+        return eng::result<eng::capture>::error("Another capture is already active.");
+    }
+
+    capturing.store(true, std::memory_order_release);
+
+    return eng::result<eng::capture>::success(std::move(capture));
+}
+
+void eng::capture::end_frame() {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    uint64_t timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - state->start_time).count());
+
+    append(state->payload, timestamp);
+    write_record(*state, record_type::end_frame);
+
+    ++state->stats.frames;
+}
+
+bool eng::capture::active() {
+    return capturing.load(std::memory_order_acquire);
+}
+
+eng::capture::capture() {}
+
+eng::capture::~capture() {
+    destroy();
+}
+
+eng::capture::capture(eng::capture&& other) noexcept
+    : shared(std::move(other.shared)) {}
+
+eng::capture& eng::capture::operator=(eng::capture&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        shared = std::move(other.shared);
+    }
+
+    return *this;
+}
+
+void eng::capture::finish() {
+    if (!valid()) {
+        return;
+    }
+
+    // nothing else can become active while this one still is, so the flag is cleared before the state
+    if (std::atomic_load(&active_state) == shared) {
+        capturing.store(false, std::memory_order_release);
+        std::atomic_store(&active_state, std::shared_ptr<capture_state>());
+    }
+
+    // a hook that loaded the state before it was cleared holds its own reference, sees the closed file and returns
+    std::lock_guard<std::mutex> lock(shared->mutex);
+
+    if (shared->file.is_open()) {
+        shared->file.close();
+    }
+}
+
+eng::capture::statistics eng::capture::get_statistics() const {
+    if (!valid()) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(shared->mutex);
+
+    return shared->stats;
+}
+
+void eng::capture::record_create_buffer(VkBuffer buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool concurrent) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, create_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(size));
+    append(state->payload, static_cast<uint32_t>(usage));
+    append(state->payload, static_cast<uint32_t>(properties));
+    append(state->payload, static_cast<uint8_t>(concurrent));
+    write_record(*state, record_type::create_buffer);
+}
+
+void eng::capture::record_destroy_buffer(VkBuffer buffer) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    uint32_t id = release_id(*state, buffer_object, handle_value(buffer));
+
+    if (id != 0) {
+        append(state->payload, id);
+        write_record(*state, record_type::destroy_buffer);
+    }
+}
+
+void eng::capture::record_write_buffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(offset));
+    append(state->payload, static_cast<uint64_t>(size));
+    append_bytes(state->payload, data, static_cast<size_t>(size));
+    write_record(*state, record_type::write_buffer);
+}
+
+void eng::capture::record_create_compute_pipeline(VkPipeline pipeline, const std::vector<uint32_t>& code, const std::vector<VkDescriptorSetLayout>& set_layouts,
+    uint32_t push_constant_size, const std::vector<uint32_t>& specialization_constants) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    uint64_t hash = hash_code(code);
+    auto shader = state->shader_ids.find(hash);
+
+    if (shader == state->shader_ids.end()) {
+        shader = state->shader_ids.emplace(hash, state->next_id++).first;
+
+        append(state->payload, shader->second);
+        append(state->payload, static_cast<uint32_t>(code.size()));
+        append_bytes(state->payload, code.data(), code.size() * sizeof(uint32_t));
+        write_record(*state, record_type::create_shader);
+    }
+
+    append(state->payload, create_id(*state, pipeline_object, handle_value(pipeline)));
+    append(state->payload, shader->second);
+    append(state->payload, push_constant_size);
+    append(state->payload, static_cast<uint32_t>(set_layouts.size()));
+
+    for (VkDescriptorSetLayout layout : set_layouts) {
+        append(state->payload, find_id(*state, layout_object, handle_value(layout)));
+    }
+
+    append(state->payload, static_cast<uint32_t>(specialization_constants.size()));
+    append_bytes(state->payload, specialization_constants.data(), specialization_constants.size() * sizeof(uint32_t));
+    write_record(*state, record_type::create_compute_pipeline);
+}
+
+void eng::capture::record_destroy_pipeline(VkPipeline pipeline) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    uint32_t id = release_id(*state, pipeline_object, handle_value(pipeline));
+
+    if (id != 0) {
+        append(state->payload, id);
+        write_record(*state, record_type::destroy_pipeline);
+    }
+}
+
+void eng::capture::record_create_descriptor_layout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t max_sets) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, create_id(*state, layout_object, handle_value(layout)));
+    append(state->payload, max_sets);
+    append(state->payload, static_cast<uint32_t>(bindings.size()));
+
+    for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+        append(state->payload, binding.binding);
+        append(state->payload, static_cast<uint32_t>(binding.descriptorType));
+        append(state->payload, static_cast<uint32_t>(binding.stageFlags));
+        append(state->payload, binding.descriptorCount);
+    }
+
+    write_record(*state, record_type::create_descriptor_layout);
+}
+
+void eng::capture::record_destroy_descriptor_layout(VkDescriptorSetLayout layout) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    uint32_t id = release_id(*state, layout_object, handle_value(layout));
+
+    if (id != 0) {
+        append(state->payload, id);
+        write_record(*state, record_type::destroy_descriptor_layout);
+    }
+}
+
+void eng::capture::record_allocate_descriptor_set(VkDescriptorSet set, VkDescriptorSetLayout layout) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, create_id(*state, set_object, handle_value(set)));
+    append(state->payload, find_id(*state, layout_object, handle_value(layout)));
+    write_record(*state, record_type::allocate_descriptor_set);
+}
+
+void eng::capture::record_write_descriptor_buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, set_object, handle_value(set)));
+    append(state->payload, binding);
+    append(state->payload, static_cast<uint32_t>(type));
+    append(state->payload, find_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(offset));
+    append(state->payload, static_cast<uint64_t>(range));
+    write_record(*state, record_type::write_descriptor_buffer);
+}
+
+void eng::capture::record_bind_pipeline(VkCommandBuffer command_buffer, VkPipeline pipeline) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, pipeline_object, handle_value(pipeline)));
+    write_record(*state, record_type::bind_pipeline);
+}
+
+void eng::capture::record_bind_descriptor_set(VkCommandBuffer command_buffer, VkPipeline pipeline, uint32_t index, VkDescriptorSet set) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, pipeline_object, handle_value(pipeline)));
+    append(state->payload, index);
+    append(state->payload, find_id(*state, set_object, handle_value(set)));
+    write_record(*state, record_type::bind_descriptor_set);
+}
+
+void eng::capture::record_push_constants(VkCommandBuffer command_buffer, VkPipeline pipeline, const void* data, uint32_t size, uint32_t offset) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, pipeline_object, handle_value(pipeline)));
+    append(state->payload, offset);
+    append(state->payload, size);
+    append_bytes(state->payload, data, size);
+    write_record(*state, record_type::push_constants);
+}
+
+void eng::capture::record_dispatch(VkCommandBuffer command_buffer, uint32_t x, uint32_t y, uint32_t z) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, x);
+    append(state->payload, y);
+    append(state->payload, z);
+    write_record(*state, record_type::dispatch);
+}
+
+void eng::capture::record_dispatch_indirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(offset));
+    write_record(*state, record_type::dispatch_indirect);
+}
+
+void eng::capture::record_pipeline_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags source_stages, VkPipelineStageFlags destination_stages,
+    VkAccessFlags source_access, VkAccessFlags destination_access) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, static_cast<uint32_t>(source_stages));
+    append(state->payload, static_cast<uint32_t>(destination_stages));
+    append(state->payload, static_cast<uint32_t>(source_access));
+    append(state->payload, static_cast<uint32_t>(destination_access));
+    write_record(*state, record_type::pipeline_barrier);
+}
+
+void eng::capture::record_fill_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(offset));
+    append(state->payload, static_cast<uint64_t>(size));
+    append(state->payload, value);
+    write_record(*state, record_type::fill_buffer);
+}
+
+void eng::capture::record_copy_buffer(VkCommandBuffer command_buffer, VkBuffer source, VkBuffer destination, const VkBufferCopy& region) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, buffer_object, handle_value(source)));
+    append(state->payload, find_id(*state, buffer_object, handle_value(destination)));
+    append(state->payload, static_cast<uint64_t>(region.srcOffset));
+    append(state->payload, static_cast<uint64_t>(region.dstOffset));
+    append(state->payload, static_cast<uint64_t>(region.size));
+    write_record(*state, record_type::copy_buffer);
+}
+
+void eng::capture::record_update_buffer(VkCommandBuffer command_buffer, VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, find_id(*state, buffer_object, handle_value(buffer)));
+    append(state->payload, static_cast<uint64_t>(offset));
+    append(state->payload, static_cast<uint64_t>(size));
+    append_bytes(state->payload, data, static_cast<size_t>(size));
+    write_record(*state, record_type::update_buffer);
+}
+
+void eng::capture::record_write_descriptor_image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type) {
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, set_object, handle_value(set)));
+    append(state->payload, binding);
+    append(state->payload, static_cast<uint32_t>(type));
+    write_record(*state, record_type::write_descriptor_image);
+}
+
+void eng::capture::record_unreplayable(VkCommandBuffer command_buffer, eng::capture::unreplayable_kind kind, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    locked_state state = acquire();
+
+    if (!state) {
+        return;
+    }
+
+    append(state->payload, find_id(*state, command_buffer_object, handle_value(command_buffer)));
+    append(state->payload, static_cast<uint32_t>(kind));
+    append(state->payload, count);
+    write_record(*state, record_type::unreplayable_command);
+
+    state->stats.unreplayable_commands += count;
+}
+
+eng::capture::locked_state eng::capture::acquire() {
+    if (!capturing.load(std::memory_order_relaxed)) {
+        return {};
+    }
+
+    locked_state state;
+    state.state = std::atomic_load(&active_state);
+
+    if (state.state == nullptr) {
+        return {};
+    }
+
+    state.lock = std::unique_lock<std::mutex>(state.state->mutex);
+
+    if (!state.state->file.is_open()) {
+        return {};
+    }
+
+    state.state->payload.clear();
+
+    return state;
+}
+
+uint32_t eng::capture::create_id(eng::capture::capture_state& state, eng::capture::object_kind kind, uint64_t handle) {
+    uint32_t id = state.next_id++;
+    state.ids[kind][handle] = id;
+
+    return id;
+}
+
+uint32_t eng::capture::find_id(eng::capture::capture_state& state, eng::capture::object_kind kind, uint64_t handle) {
+    auto found = state.ids[kind].find(handle);
+
+    if (found != state.ids[kind].end()) {
+        return found->second;
+    }
+
+    // command buffers are never created through the engine, they get an id the first time they're used
+    if (kind == command_buffer_object) {
+        return create_id(state, kind, handle);
+    }
+
+    ++state.stats.missing_references;
+
+    return 0;
+}
+
+uint32_t eng::capture::release_id(eng::capture::capture_state& state, eng::capture::object_kind kind, uint64_t handle) {
+    auto found = state.ids[kind].find(handle);
+
+    if (found == state.ids[kind].end()) {
+        return 0;
+    }
+
+    uint32_t id = found->second;
+    state.ids[kind].erase(found);
+
+    return id;
+}
+
+void eng::capture::write_record(eng::capture::capture_state& state, eng::capture::record_type type) {
+    uint8_t type_byte = static_cast<uint8_t>(type);
+    uint32_t size = static_cast<uint32_t>(state.payload.size());
+
+    state.file.write(reinterpret_cast<const char*>(&type_byte), sizeof(type_byte));
+    state.file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    state.file.write(reinterpret_cast<const char*>(state.payload.data()), state.payload.size());
+
+    state.payload.clear();
+
+    ++state.stats.records;
+    state.stats.bytes += sizeof(type_byte) + sizeof(size) + size;
+}
+
+void eng::capture::destroy() {
+    finish();
+
+    shared.reset();
+}
@@ -0,0 +1,230 @@
+#include "../include/compute_pipeline.hpp"
+#include "../include/capture.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+eng::result<eng::compute_pipeline> eng::compute_pipeline::create_compute_pipeline(const eng::device& device, const char* shader_path,
+    const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size, const std::vector<uint32_t>& specialization_constants) {
+    eng::result<std::vector<uint32_t>> code_result = eng::shader_module::read_shader_file(shader_path);
+
+    if (code_result.is_error()) {
+        return eng::result<eng::compute_pipeline>::error(code_result.error_message());
+    }
+
+    return create_compute_pipeline(device, code_result.unwrap(), set_layouts, push_constant_size, specialization_constants);
+}
+
+eng::result<eng::compute_pipeline> eng::compute_pipeline::create_compute_pipeline(const eng::device& device, const char* shader_directory,
+    const char* shader_name, const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size,
+    const std::vector<uint32_t>& specialization_constants) {
+    if (shader_directory == nullptr || shader_name == nullptr) {
+        return eng::result<eng::compute_pipeline>::error("Invalid shader path.");
+    }
+
+    std::string path = std::string(shader_directory) + "/" + shader_name;
+
+    return create_compute_pipeline(device, path.c_str(), set_layouts, push_constant_size, specialization_constants);
+}
+
+eng::result<eng::compute_pipeline> eng::compute_pipeline::create_compute_pipeline(const eng::device& device, const std::vector<uint32_t>& code,
+    const std::vector<VkDescriptorSetLayout>& set_layouts, uint32_t push_constant_size, const std::vector<uint32_t>& specialization_constants) {
+    if (!device.valid()) {
+        return eng::result<eng::compute_pipeline>::error("Invalid device.");
+    }
+
+    if (push_constant_size % 4 != 0) {
+        return eng::result<eng::compute_pipeline>::error("Push constant size must be a multiple of 4.");
+    }
+
+    eng::result<eng::shader_module> shader_result = eng::shader_module::create_shader_module(device, code);
+
+    if (shader_result.is_error()) {
+        return eng::result<eng::compute_pipeline>::error(shader_result.error_message());
+    }
+
+    eng::compute_pipeline pipeline;
+    pipeline.logical_device_handle = device.get_vulkan_logical_device();
+    pipeline.push_constant_size = push_constant_size;
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = push_constant_size;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+    pipeline_layout_create_info.pSetLayouts = set_layouts.data();
+    pipeline_layout_create_info.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+    pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(pipeline.logical_device_handle, &pipeline_layout_create_info, nullptr, &pipeline.pipeline_layout_handle) != VK_SUCCESS) {
+        return eng::result<eng::compute_pipeline>::error("Failed to create compute pipeline layout.");
+    }
+
+    std::vector<VkSpecializationMapEntry> map_entries(specialization_constants.size());
+
+    for (uint32_t i = 0; i < map_entries.size(); ++i) {
+        map_entries[i].constantID = i;
+        map_entries[i].offset = i * sizeof(uint32_t);
+        map_entries[i].size = sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo specialization_info{};
+    specialization_info.mapEntryCount = static_cast<uint32_t>(map_entries.size());
+    specialization_info.pMapEntries = map_entries.data();
+    specialization_info.dataSize = specialization_constants.size() * sizeof(uint32_t);
+    specialization_info.pData = specialization_constants.data();
+
+    VkComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_create_info.stage.module = shader_result.unwrap().get_vulkan_shader_module();
+    pipeline_create_info.stage.pName = "main";
+    pipeline_create_info.stage.pSpecializationInfo = specialization_constants.empty() ? nullptr : &specialization_info;
+    pipeline_create_info.layout = pipeline.pipeline_layout_handle;
+
+    if (vkCreateComputePipelines(pipeline.logical_device_handle, VK_NULL_HANDLE, 1, &pipeline_create_info, nullptr, &pipeline.pipeline_handle) != VK_SUCCESS) {
+        return eng::result<eng::compute_pipeline>::error("Failed to create compute pipeline.");
+    }
+
+    eng::capture::record_create_compute_pipeline(pipeline.pipeline_handle, code, set_layouts, push_constant_size, specialization_constants);
+
+    return eng::result<eng::compute_pipeline>::success(std::move(pipeline));
+}
+
+void eng::compute_pipeline::record_barrier(VkCommandBuffer command_buffer) {
+    record_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void eng::compute_pipeline::record_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags source_stages, VkPipelineStageFlags destination_stages,
+    VkAccessFlags source_access, VkAccessFlags destination_access) {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = source_access;
+    barrier.dstAccessMask = destination_access;
+
+    vkCmdPipelineBarrier(command_buffer, source_stages, destination_stages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    eng::capture::record_pipeline_barrier(command_buffer, source_stages, destination_stages, source_access, destination_access);
+}
+
+void eng::compute_pipeline::record_fill_buffer(VkCommandBuffer command_buffer, const eng::buffer& buffer, uint32_t value) {
+    vkCmdFillBuffer(command_buffer, buffer.get_vulkan_buffer(), 0, VK_WHOLE_SIZE, value);
+
+    eng::capture::record_fill_buffer(command_buffer, buffer.get_vulkan_buffer(), 0, VK_WHOLE_SIZE, value);
+}
+
+void eng::compute_pipeline::record_copy_buffer(VkCommandBuffer command_buffer, const eng::buffer& source, const eng::buffer& destination, const VkBufferCopy& region) {
+    if (region.srcOffset + region.size > source.get_size() || region.dstOffset + region.size > destination.get_size()) {
+        throw std::out_of_range("Buffer copy out of range.");
+    }
+
+    vkCmdCopyBuffer(command_buffer, source.get_vulkan_buffer(), destination.get_vulkan_buffer(), 1, &region);
+
+    eng::capture::record_copy_buffer(command_buffer, source.get_vulkan_buffer(), destination.get_vulkan_buffer(), region);
+}
+
+void eng::compute_pipeline::record_update_buffer(VkCommandBuffer command_buffer, const eng::buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    if (size == 0 || size % 4 != 0 || size > 65536 || offset % 4 != 0) {
+        throw std::invalid_argument("Buffer update size and offset must be multiples of 4 and at most 65536 bytes.");
+    }
+
+    if (offset + size > buffer.get_size()) {
+        throw std::out_of_range("Buffer update out of range.");
+    }
+
+    vkCmdUpdateBuffer(command_buffer, buffer.get_vulkan_buffer(), offset, size, data);
+
+    eng::capture::record_update_buffer(command_buffer, buffer.get_vulkan_buffer(), data, size, offset);
+}
+
+eng::compute_pipeline::compute_pipeline()
+    : logical_device_handle(VK_NULL_HANDLE),
+    pipeline_layout_handle(VK_NULL_HANDLE),
+    pipeline_handle(VK_NULL_HANDLE),
+    push_constant_size(0) {}
+
+eng::compute_pipeline::~compute_pipeline() {
+    destroy();
+}
+
+eng::compute_pipeline::compute_pipeline(eng::compute_pipeline&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    pipeline_layout_handle(std::exchange(other.pipeline_layout_handle, VK_NULL_HANDLE)),
+    pipeline_handle(std::exchange(other.pipeline_handle, VK_NULL_HANDLE)),
+    push_constant_size(std::exchange(other.push_constant_size, 0)) {}
+
+eng::compute_pipeline& eng::compute_pipeline::operator=(eng::compute_pipeline&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        pipeline_layout_handle = std::exchange(other.pipeline_layout_handle, VK_NULL_HANDLE);
+        pipeline_handle = std::exchange(other.pipeline_handle, VK_NULL_HANDLE);
+        push_constant_size = std::exchange(other.push_constant_size, 0);
+    }
+
+    return *this;
+}
+
+void eng::compute_pipeline::bind(VkCommandBuffer command_buffer) const {
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_handle);
+
+    eng::capture::record_bind_pipeline(command_buffer, pipeline_handle);
+}
+
+void eng::compute_pipeline::bind_descriptor_set(VkCommandBuffer command_buffer, uint32_t index, VkDescriptorSet set) const {
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_handle, index, 1, &set, 0, nullptr);
+
+    eng::capture::record_bind_descriptor_set(command_buffer, pipeline_handle, index, set);
+}
+
+void eng::compute_pipeline::push_constants(VkCommandBuffer command_buffer, const void* data, uint32_t size, uint32_t offset) const {
+    if (offset + size > push_constant_size) {
+        throw std::out_of_range("Push constants exceed the pipeline's push constant range.");
+    }
+
+    vkCmdPushConstants(command_buffer, pipeline_layout_handle, VK_SHADER_STAGE_COMPUTE_BIT, offset, size, data);
+
+    eng::capture::record_push_constants(command_buffer, pipeline_handle, data, size, offset);
+}
+
+void eng::compute_pipeline::dispatch(VkCommandBuffer command_buffer, uint32_t x, uint32_t y, uint32_t z) const {
+    vkCmdDispatch(command_buffer, x, y, z);
+
+    eng::capture::record_dispatch(command_buffer, x, y, z);
+}
+
+void eng::compute_pipeline::dispatch_indirect(VkCommandBuffer command_buffer, const eng::buffer& arguments, VkDeviceSize offset) const {
+    if (offset + sizeof(VkDispatchIndirectCommand) > arguments.get_size()) {
+        throw std::out_of_range("Indirect dispatch arguments exceed the buffer.");
+    }
+
+    vkCmdDispatchIndirect(command_buffer, arguments.get_vulkan_buffer(), offset);
+
+    eng::capture::record_dispatch_indirect(command_buffer, arguments.get_vulkan_buffer(), offset);
+}
+
+void eng::compute_pipeline::destroy() {
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (pipeline_handle != VK_NULL_HANDLE) {
+        eng::capture::record_destroy_pipeline(pipeline_handle);
+        vkDestroyPipeline(logical_device_handle, pipeline_handle, nullptr);
+    }
+
+    if (pipeline_layout_handle != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(logical_device_handle, pipeline_layout_handle, nullptr);
+    }
+
+    pipeline_handle = VK_NULL_HANDLE;
+    pipeline_layout_handle = VK_NULL_HANDLE;
+    logical_device_handle = VK_NULL_HANDLE;
+}
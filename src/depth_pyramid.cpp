@@ -0,0 +1,421 @@
+#include "../include/depth_pyramid.hpp"
+#include "../include/capture.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+eng::result<eng::depth_pyramid> eng::depth_pyramid::create_depth_pyramid(const eng::device& device, uint32_t width, uint32_t height, bool reversed_z, const char* shader_path) {
+    if (!device.valid()) {
+        return eng::result<eng::depth_pyramid>::error("Invalid device.");
+    }
+
+    if (width == 0 || height == 0) {
+        return eng::result<eng::depth_pyramid>::error("Depth pyramid size must be greater than zero.");
+    }
+
+    eng::depth_pyramid pyramid;
+    pyramid.logical_device_handle = device.get_vulkan_logical_device();
+    pyramid.width = width;
+    pyramid.height = height;
+    pyramid.reversed_z = reversed_z;
+
+    uint32_t largest_dimension = std::max(width, height);
+
+    while (largest_dimension > 0) {
+        ++pyramid.level_count;
+        largest_dimension >>= 1;
+    }
+
+    VkImageCreateInfo image_create_info{};
+    image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType = VK_IMAGE_TYPE_2D;
+    image_create_info.format = VK_FORMAT_R32_SFLOAT;
+    image_create_info.extent = { width, height, 1 };
+    image_create_info.mipLevels = pyramid.level_count;
+    image_create_info.arrayLayers = 1;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(pyramid.logical_device_handle, &image_create_info, nullptr, &pyramid.image_handle) != VK_SUCCESS) {
+        return eng::result<eng::depth_pyramid>::error("Failed to create depth pyramid image.");
+    }
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(pyramid.logical_device_handle, pyramid.image_handle, &memory_requirements);
+
+    eng::result<uint32_t> memory_type_result = device.find_memory_type(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memory_type_result.is_error()) {
+        return eng::result<eng::depth_pyramid>::error(memory_type_result.error_message());
+    }
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = memory_requirements.size;
+    allocate_info.memoryTypeIndex = memory_type_result.unwrap();
+
+    if (vkAllocateMemory(pyramid.logical_device_handle, &allocate_info, nullptr, &pyramid.memory_handle) != VK_SUCCESS) {
+        return eng::result<eng::depth_pyramid>::error("Failed to allocate depth pyramid memory.");
+    }
+
+    vkBindImageMemory(pyramid.logical_device_handle, pyramid.image_handle, pyramid.memory_handle, 0);
+
+    VkImageViewCreateInfo view_create_info{};
+    view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_create_info.image = pyramid.image_handle;
+    view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = VK_FORMAT_R32_SFLOAT;
+    view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_create_info.subresourceRange.baseMipLevel = 0;
+    view_create_info.subresourceRange.levelCount = pyramid.level_count;
+    view_create_info.subresourceRange.baseArrayLayer = 0;
+    view_create_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(pyramid.logical_device_handle, &view_create_info, nullptr, &pyramid.image_view_handle) != VK_SUCCESS) {
+        return eng::result<eng::depth_pyramid>::error("Failed to create depth pyramid image view.");
+    }
+
+    pyramid.level_view_handles.resize(pyramid.level_count, VK_NULL_HANDLE);
+
+    for (uint32_t level = 0; level < pyramid.level_count; ++level) {
+        view_create_info.subresourceRange.baseMipLevel = level;
+        view_create_info.subresourceRange.levelCount = 1;
+
+        if (vkCreateImageView(pyramid.logical_device_handle, &view_create_info, nullptr, &pyramid.level_view_handles[level]) != VK_SUCCESS) {
+            return eng::result<eng::depth_pyramid>::error("Failed to create depth pyramid level view.");
+        }
+    }
+
+    VkSamplerCreateInfo sampler_create_info{};
+    sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_create_info.magFilter = VK_FILTER_NEAREST;
+    sampler_create_info.minFilter = VK_FILTER_NEAREST;
+    sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_create_info.minLod = 0.0f;
+    sampler_create_info.maxLod = static_cast<float>(pyramid.level_count);
+
+    if (vkCreateSampler(pyramid.logical_device_handle, &sampler_create_info, nullptr, &pyramid.sampler_handle) != VK_SUCCESS) {
+        return eng::result<eng::depth_pyramid>::error("Failed to create depth pyramid sampler.");
+    }
+
+    eng::result<eng::descriptor_layout> layout_result = eng::descriptor_layout::create_descriptor_layout(device,
+        { { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER }, { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE } }, pyramid.level_count);
+
+    if (layout_result.is_error()) {
+        return eng::result<eng::depth_pyramid>::error(layout_result.error_message());
+    }
+
+    pyramid.reduce_layout = std::move(layout_result.unwrap());
+    pyramid.reduce_sets.resize(pyramid.level_count, VK_NULL_HANDLE);
+
+    for (VkDescriptorSet& set : pyramid.reduce_sets) {
+        eng::result<VkDescriptorSet> set_result = pyramid.reduce_layout.allocate_set();
+
+        if (set_result.is_error()) {
+            return eng::result<eng::depth_pyramid>::error(set_result.error_message());
+        }
+
+        set = set_result.unwrap();
+    }
+
+    // level n reads level n - 1, the source of level 0 is written by set_depth_source
+    eng::descriptor_writer writer;
+
+    for (uint32_t level = 0; level < pyramid.level_count; ++level) {
+        if (level > 0) {
+            writer.write_image(pyramid.reduce_sets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                pyramid.level_view_handles[level - 1], pyramid.sampler_handle, VK_IMAGE_LAYOUT_GENERAL);
+        }
+
+        writer.write_image(pyramid.reduce_sets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            pyramid.level_view_handles[level], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    writer.update(device);
+
+    eng::result<eng::compute_pipeline> pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, shader_path,
+        { pyramid.reduce_layout.get_vulkan_descriptor_set_layout() }, sizeof(reduce_constants));
+
+    if (pipeline_result.is_error()) {
+        return eng::result<eng::depth_pyramid>::error(pipeline_result.error_message());
+    }
+
+    pyramid.reduce_pipeline = std::move(pipeline_result.unwrap());
+
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &physical_device_properties);
+
+    // without timestamp support on every graphics and compute queue the build cost is simply not reported
+    if (physical_device_properties.limits.timestampComputeAndGraphics) {
+        VkQueryPoolCreateInfo query_pool_create_info{};
+        query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_create_info.queryCount = 2;
+
+        if (vkCreateQueryPool(pyramid.logical_device_handle, &query_pool_create_info, nullptr, &pyramid.query_pool_handle) != VK_SUCCESS) {
+            return eng::result<eng::depth_pyramid>::error("Failed to create depth pyramid query pool.");
+        }
+
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, nullptr);
+
+        std::vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, families.data());
+
+        // the build can be recorded for either queue, so differences are taken modulo the narrower of their counters
+        uint32_t valid_bits = std::min(families[device.get_graphics_queue_family()].timestampValidBits,
+            families[device.get_compute_queue_family()].timestampValidBits);
+
+        pyramid.timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+        pyramid.timestamp_period = physical_device_properties.limits.timestampPeriod;
+    }
+
+    return eng::result<eng::depth_pyramid>::success(std::move(pyramid));
+}
+
+eng::depth_pyramid::depth_pyramid()
+    : logical_device_handle(VK_NULL_HANDLE),
+    image_handle(VK_NULL_HANDLE),
+    memory_handle(VK_NULL_HANDLE),
+    image_view_handle(VK_NULL_HANDLE),
+    sampler_handle(VK_NULL_HANDLE),
+    query_pool_handle(VK_NULL_HANDLE),
+    width(0),
+    height(0),
+    level_count(0),
+    reversed_z(false),
+    initialized(false),
+    has_depth_source(false),
+    query_pending(false),
+    timestamp_mask(~0ull),
+    timestamp_period(0.0),
+    build_milliseconds(-1.0) {}
+
+eng::depth_pyramid::~depth_pyramid() {
+    destroy();
+}
+
+eng::depth_pyramid::depth_pyramid(eng::depth_pyramid&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    image_handle(std::exchange(other.image_handle, VK_NULL_HANDLE)),
+    memory_handle(std::exchange(other.memory_handle, VK_NULL_HANDLE)),
+    image_view_handle(std::exchange(other.image_view_handle, VK_NULL_HANDLE)),
+    level_view_handles(std::move(other.level_view_handles)),
+    sampler_handle(std::exchange(other.sampler_handle, VK_NULL_HANDLE)),
+    query_pool_handle(std::exchange(other.query_pool_handle, VK_NULL_HANDLE)),
+    reduce_layout(std::move(other.reduce_layout)),
+    reduce_sets(std::move(other.reduce_sets)),
+    reduce_pipeline(std::move(other.reduce_pipeline)),
+    width(other.width),
+    height(other.height),
+    level_count(std::exchange(other.level_count, 0)),
+    reversed_z(other.reversed_z),
+    initialized(other.initialized),
+    has_depth_source(other.has_depth_source),
+    query_pending(other.query_pending),
+    timestamp_mask(other.timestamp_mask),
+    timestamp_period(other.timestamp_period),
+    build_milliseconds(other.build_milliseconds) {
+    other.level_view_handles.clear();
+    other.reduce_sets.clear();
+}
+
+eng::depth_pyramid& eng::depth_pyramid::operator=(eng::depth_pyramid&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        image_handle = std::exchange(other.image_handle, VK_NULL_HANDLE);
+        memory_handle = std::exchange(other.memory_handle, VK_NULL_HANDLE);
+        image_view_handle = std::exchange(other.image_view_handle, VK_NULL_HANDLE);
+        level_view_handles = std::move(other.level_view_handles);
+        sampler_handle = std::exchange(other.sampler_handle, VK_NULL_HANDLE);
+        query_pool_handle = std::exchange(other.query_pool_handle, VK_NULL_HANDLE);
+        reduce_layout = std::move(other.reduce_layout);
+        reduce_sets = std::move(other.reduce_sets);
+        reduce_pipeline = std::move(other.reduce_pipeline);
+        width = other.width;
+        height = other.height;
+        level_count = std::exchange(other.level_count, 0);
+        reversed_z = other.reversed_z;
+        initialized = other.initialized;
+        has_depth_source = other.has_depth_source;
+        query_pending = other.query_pending;
+        timestamp_mask = other.timestamp_mask;
+        timestamp_period = other.timestamp_period;
+        build_milliseconds = other.build_milliseconds;
+
+        other.level_view_handles.clear();
+        other.reduce_sets.clear();
+    }
+
+    return *this;
+}
+
+void eng::depth_pyramid::set_depth_source(const eng::device& device, VkImageView depth_view, VkImageLayout depth_layout) {
+    if (depth_view == VK_NULL_HANDLE) {
+        throw std::invalid_argument("Invalid depth image view.");
+    }
+
+    eng::descriptor_writer writer;
+
+    writer.write_image(reduce_sets[0], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depth_view, sampler_handle, depth_layout)
+        .update(device);
+
+    has_depth_source = true;
+}
+
+void eng::depth_pyramid::record_build(VkCommandBuffer command_buffer) {
+    if (!has_depth_source) {
+        throw std::logic_error("Called record_build on a depth pyramid without a depth source.");
+    }
+
+    if (query_pool_handle != VK_NULL_HANDLE) {
+        // collect the previous build before its queries are reset
+        get_build_milliseconds();
+
+        vkCmdResetQueryPool(command_buffer, query_pool_handle, 0, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_handle, 0);
+    }
+
+    VkImageMemoryBarrier pyramid_barrier{};
+    pyramid_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    pyramid_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramid_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramid_barrier.image = image_handle;
+    pyramid_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramid_barrier.subresourceRange.baseMipLevel = 0;
+    pyramid_barrier.subresourceRange.levelCount = level_count;
+    pyramid_barrier.subresourceRange.baseArrayLayer = 0;
+    pyramid_barrier.subresourceRange.layerCount = 1;
+    pyramid_barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    pyramid_barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    pyramid_barrier.oldLayout = initialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramid_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    // depth writes from the prepass have to be visible before the first reduction samples them
+    VkMemoryBarrier depth_barrier{};
+    depth_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    depth_barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depth_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(command_buffer,
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &depth_barrier, 0, nullptr, 1, &pyramid_barrier);
+
+    initialized = true;
+
+    reduce_pipeline.bind(command_buffer);
+
+    uint32_t source_width = width;
+    uint32_t source_height = height;
+
+    for (uint32_t level = 0; level < level_count; ++level) {
+        uint32_t destination_width = level == 0 ? width : std::max(1u, source_width / 2);
+        uint32_t destination_height = level == 0 ? height : std::max(1u, source_height / 2);
+
+        reduce_constants constants{};
+        constants.source_width = source_width;
+        constants.source_height = source_height;
+        constants.destination_width = destination_width;
+        constants.destination_height = destination_height;
+        constants.reduce_min = reversed_z ? 1 : 0;
+
+        reduce_pipeline.bind_descriptor_set(command_buffer, 0, reduce_sets[level]);
+        reduce_pipeline.push_constants(command_buffer, constants);
+        reduce_pipeline.dispatch(command_buffer,
+            compute_pipeline::group_count(destination_width, workgroup_size),
+            compute_pipeline::group_count(destination_height, workgroup_size));
+
+        pyramid_barrier.subresourceRange.baseMipLevel = level;
+        pyramid_barrier.subresourceRange.levelCount = 1;
+        pyramid_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        pyramid_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        pyramid_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramid_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        vkCmdPipelineBarrier(command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &pyramid_barrier);
+
+        source_width = destination_width;
+        source_height = destination_height;
+    }
+
+    // the layout transition and one barrier per level
+    eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::image_barrier, level_count + 1);
+
+    if (query_pool_handle != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool_handle, 1);
+
+        query_pending = true;
+    }
+}
+
+double eng::depth_pyramid::get_build_milliseconds() {
+    if (query_pending) {
+        uint64_t timestamps[2];
+
+        VkResult query_result = vkGetQueryPoolResults(logical_device_handle, query_pool_handle, 0, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (query_result == VK_SUCCESS) {
+            build_milliseconds = static_cast<double>((timestamps[1] - timestamps[0]) & timestamp_mask) * timestamp_period / 1000000.0;
+            query_pending = false;
+        }
+    }
+
+    return build_milliseconds;
+}
+
+void eng::depth_pyramid::destroy() {
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (query_pool_handle != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(logical_device_handle, query_pool_handle, nullptr);
+    }
+
+    // the sets reference the views and the sampler, so they go first
+    reduce_pipeline = eng::compute_pipeline();
+    reduce_layout = eng::descriptor_layout();
+    reduce_sets.clear();
+
+    if (sampler_handle != VK_NULL_HANDLE) {
+        vkDestroySampler(logical_device_handle, sampler_handle, nullptr);
+    }
+
+    for (VkImageView level_view_handle : level_view_handles) {
+        if (level_view_handle != VK_NULL_HANDLE) {
+            vkDestroyImageView(logical_device_handle, level_view_handle, nullptr);
+        }
+    }
+
+    if (image_view_handle != VK_NULL_HANDLE) {
+        vkDestroyImageView(logical_device_handle, image_view_handle, nullptr);
+    }
+
+    if (image_handle != VK_NULL_HANDLE) {
+        vkDestroyImage(logical_device_handle, image_handle, nullptr);
+    }
+
+    if (memory_handle != VK_NULL_HANDLE) {
+        vkFreeMemory(logical_device_handle, memory_handle, nullptr);
+    }
+
+    query_pool_handle = VK_NULL_HANDLE;
+    sampler_handle = VK_NULL_HANDLE;
+    level_view_handles.clear();
+    image_view_handle = VK_NULL_HANDLE;
+    image_handle = VK_NULL_HANDLE;
+    memory_handle = VK_NULL_HANDLE;
+    logical_device_handle = VK_NULL_HANDLE;
+}
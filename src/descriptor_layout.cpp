@@ -0,0 +1,222 @@
+#include "../include/descriptor_layout.hpp"
+#include "../include/capture.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+eng::result<eng::descriptor_layout> eng::descriptor_layout::create_descriptor_layout(const eng::device& device, const std::vector<binding>& bindings, uint32_t max_sets) {
+    if (!device.valid()) {
+        return eng::result<eng::descriptor_layout>::error("Invalid device.");
+    }
+
+    if (bindings.empty()) {
+        return eng::result<eng::descriptor_layout>::error("Descriptor layout needs at least one binding.");
+    }
+
+    if (max_sets == 0) {
+        return eng::result<eng::descriptor_layout>::error("Max sets must be greater than zero.");
+    }
+
+    eng::descriptor_layout layout;
+    layout.logical_device_handle = device.get_vulkan_logical_device();
+    layout.max_sets = max_sets;
+
+    std::vector<VkDescriptorSetLayoutBinding> layout_bindings(bindings.size());
+    std::vector<VkDescriptorPoolSize> pool_sizes;
+
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        layout_bindings[i].binding = bindings[i].binding;
+        layout_bindings[i].descriptorType = bindings[i].type;
+        layout_bindings[i].descriptorCount = bindings[i].count;
+        layout_bindings[i].stageFlags = bindings[i].stages;
+
+        bool found = false;
+
+        for (VkDescriptorPoolSize& pool_size : pool_sizes) {
+            if (pool_size.type == bindings[i].type) {
+                pool_size.descriptorCount += bindings[i].count * max_sets;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            pool_sizes.push_back({ bindings[i].type, bindings[i].count * max_sets });
+        }
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+    layout_create_info.pBindings = layout_bindings.data();
+
+    if (vkCreateDescriptorSetLayout(layout.logical_device_handle, &layout_create_info, nullptr, &layout.descriptor_set_layout_handle) != VK_SUCCESS) {
+        return eng::result<eng::descriptor_layout>::error("Failed to create descriptor set layout.");
+    }
+
+    VkDescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.maxSets = max_sets;
+    pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_create_info.pPoolSizes = pool_sizes.data();
+
+    if (vkCreateDescriptorPool(layout.logical_device_handle, &pool_create_info, nullptr, &layout.descriptor_pool_handle) != VK_SUCCESS) {
+        return eng::result<eng::descriptor_layout>::error("Failed to create descriptor pool.");
+    }
+
+    eng::capture::record_create_descriptor_layout(layout.descriptor_set_layout_handle, layout_bindings, max_sets);
+
+    return eng::result<eng::descriptor_layout>::success(std::move(layout));
+}
+
+eng::descriptor_layout::descriptor_layout()
+    : logical_device_handle(VK_NULL_HANDLE),
+    descriptor_set_layout_handle(VK_NULL_HANDLE),
+    descriptor_pool_handle(VK_NULL_HANDLE),
+    max_sets(0),
+    allocated_sets(0) {}
+
+eng::descriptor_layout::~descriptor_layout() {
+    destroy();
+}
+
+eng::descriptor_layout::descriptor_layout(eng::descriptor_layout&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    descriptor_set_layout_handle(std::exchange(other.descriptor_set_layout_handle, VK_NULL_HANDLE)),
+    descriptor_pool_handle(std::exchange(other.descriptor_pool_handle, VK_NULL_HANDLE)),
+    max_sets(std::exchange(other.max_sets, 0)),
+    allocated_sets(std::exchange(other.allocated_sets, 0)) {}
+
+eng::descriptor_layout& eng::descriptor_layout::operator=(eng::descriptor_layout&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        descriptor_set_layout_handle = std::exchange(other.descriptor_set_layout_handle, VK_NULL_HANDLE);
+        descriptor_pool_handle = std::exchange(other.descriptor_pool_handle, VK_NULL_HANDLE);
+        max_sets = std::exchange(other.max_sets, 0);
+        allocated_sets = std::exchange(other.allocated_sets, 0);
+    }
+
+    return *this;
+}
+
+eng::result<VkDescriptorSet> eng::descriptor_layout::allocate_set() {
+    if (!valid()) {
+        return eng::result<VkDescriptorSet>::error("Invalid descriptor layout.");
+    }
+
+    if (allocated_sets >= max_sets) {
+        return eng::result<VkDescriptorSet>::error("Descriptor pool is out of sets.");
+    }
+
+    VkDescriptorSetAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorPool = descriptor_pool_handle;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &descriptor_set_layout_handle;
+
+    VkDescriptorSet set;
+    if (vkAllocateDescriptorSets(logical_device_handle, &allocate_info, &set) != VK_SUCCESS) {
+        return eng::result<VkDescriptorSet>::error("Failed to allocate descriptor set.");
+    }
+
+    ++allocated_sets;
+
+    eng::capture::record_allocate_descriptor_set(set, descriptor_set_layout_handle);
+
+    return eng::result<VkDescriptorSet>::success(set);
+}
+
+void eng::descriptor_layout::destroy() {
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (descriptor_pool_handle != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(logical_device_handle, descriptor_pool_handle, nullptr);
+    }
+
+    if (descriptor_set_layout_handle != VK_NULL_HANDLE) {
+        eng::capture::record_destroy_descriptor_layout(descriptor_set_layout_handle);
+        vkDestroyDescriptorSetLayout(logical_device_handle, descriptor_set_layout_handle, nullptr);
+    }
+
+    descriptor_pool_handle = VK_NULL_HANDLE;
+    descriptor_set_layout_handle = VK_NULL_HANDLE;
+    logical_device_handle = VK_NULL_HANDLE;
+    allocated_sets = 0;
+}
+
+eng::descriptor_writer& eng::descriptor_writer::write_buffer(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    if (set == VK_NULL_HANDLE || buffer == VK_NULL_HANDLE) {
+        throw std::invalid_argument("Descriptor writes need a valid set and buffer.");
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+
+    writes.push_back({ write, buffer_infos.size(), false });
+    buffer_infos.push_back({ buffer, offset, range });
+
+    return *this;
+}
+
+eng::descriptor_writer& eng::descriptor_writer::write_storage_buffer(VkDescriptorSet set, uint32_t binding, const eng::buffer& buffer) {
+    return write_buffer(set, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer.get_vulkan_buffer());
+}
+
+eng::descriptor_writer& eng::descriptor_writer::write_uniform_buffer(VkDescriptorSet set, uint32_t binding, const eng::buffer& buffer) {
+    return write_buffer(set, binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, buffer.get_vulkan_buffer());
+}
+
+eng::descriptor_writer& eng::descriptor_writer::write_image(VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView image_view, VkSampler sampler, VkImageLayout layout) {
+    if (set == VK_NULL_HANDLE) {
+        throw std::invalid_argument("Descriptor writes need a valid set.");
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorCount = 1;
+    write.descriptorType = type;
+
+    writes.push_back({ write, image_infos.size(), true });
+    image_infos.push_back({ sampler, image_view, layout });
+
+    return *this;
+}
+
+void eng::descriptor_writer::update(const eng::device& device) {
+    if (writes.empty()) {
+        return;
+    }
+
+    resolved_writes.clear();
+
+    for (pending_write& pending : writes) {
+        if (pending.image) {
+            pending.write.pImageInfo = &image_infos[pending.info_index];
+
+            eng::capture::record_write_descriptor_image(pending.write.dstSet, pending.write.dstBinding, pending.write.descriptorType);
+        }
+        else {
+            const VkDescriptorBufferInfo& info = buffer_infos[pending.info_index];
+            pending.write.pBufferInfo = &info;
+
+            eng::capture::record_write_descriptor_buffer(pending.write.dstSet, pending.write.dstBinding, pending.write.descriptorType, info.buffer, info.offset, info.range);
+        }
+
+        resolved_writes.push_back(pending.write);
+    }
+
+    vkUpdateDescriptorSets(device.get_vulkan_logical_device(), static_cast<uint32_t>(resolved_writes.size()), resolved_writes.data(), 0, nullptr);
+
+    writes.clear();
+    buffer_infos.clear();
+    image_infos.clear();
+}
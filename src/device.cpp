@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <utility>
@@ -15,10 +16,6 @@ eng::result<VkPhysicalDevice> eng::device::pick_physical_device(VkInstance insta
         return eng::result<VkPhysicalDevice>::error("Invalid Vulkan instance.");
     }
 
-    if (surface == VK_NULL_HANDLE) {
-        return eng::result<VkPhysicalDevice>::error("Invalid Vulkan surface.");
-    }
-
     uint32_t device_count = 0;
     vkEnumeratePhysicalDevices(instance, &device_count, nullptr);
 
@@ -38,22 +35,19 @@ eng::result<VkPhysicalDevice> eng::device::pick_physical_device(VkInstance insta
         }
     }
 
-    if (candidates.size() > 0 && candidates.begin()->first > 0) {
-        return eng::result<VkPhysicalDevice>::success(candidates.begin()->second);
+    // headless devices only need a graphics and compute queue, so they don't have to score above zero
+    if (candidates.size() > 0 && (candidates.rbegin()->first > 0 || surface == VK_NULL_HANDLE)) {
+        return eng::result<VkPhysicalDevice>::success(candidates.rbegin()->second);
     }
 
     return eng::result<VkPhysicalDevice>::error("Failed to find suitable GPU.");
 }
 
-eng::result<VkDevice> eng::device::create_logical_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, bool debug_layers) {
+eng::result<VkDevice> eng::device::create_logical_device(VkPhysicalDevice physical_device, VkSurfaceKHR surface, const eng::device::features& enabled_features, bool debug_layers) {
     if (physical_device == VK_NULL_HANDLE) {
         return eng::result<VkDevice>::error("Invalid Vulkan instance.");
     }
 
-    if (surface == VK_NULL_HANDLE) {
-        return eng::result<VkDevice>::error("Invalid Vulkan surface.");
-    }
-
     eng::result<eng::device::queue_family_indices> indices_result = find_queue_families(physical_device, surface);
 
     if (indices_result.is_error()) {
@@ -65,7 +59,11 @@ eng::result<VkDevice> eng::device::create_logical_device(VkPhysicalDevice physic
     eng::device::queue_family_indices indices = indices_result.unwrap();
 
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t> unique_queue_families = { indices.graphics_family.value(), indices.present_family.value() };
+    std::set<uint32_t> unique_queue_families = { indices.graphics_family.value(), indices.compute_family.value() };
+
+    if (indices.present_family.has_value()) {
+        unique_queue_families.insert(indices.present_family.value());
+    }
 
     float queue_priority = 1.0f;
     for (uint32_t queue_family : unique_queue_families) {
@@ -79,6 +77,22 @@ eng::result<VkDevice> eng::device::create_logical_device(VkPhysicalDevice physic
     }
 
     VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = enabled_features.multi_draw_indirect ? VK_TRUE : VK_FALSE;
+    device_features.drawIndirectFirstInstance = enabled_features.draw_indirect_first_instance ? VK_TRUE : VK_FALSE;
+
+    std::vector<const char*> enabled_extensions;
+
+    if (surface != VK_NULL_HANDLE) {
+        enabled_extensions.assign(eng::device_extensions.begin(), eng::device_extensions.end());
+    }
+
+    if (enabled_features.draw_indirect_count) {
+        enabled_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    if (enabled_features.memory_budget) {
+        enabled_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -86,8 +100,8 @@ eng::result<VkDevice> eng::device::create_logical_device(VkPhysicalDevice physic
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     createInfo.pEnabledFeatures = &device_features;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(eng::device_extensions.size()); 
-    createInfo.ppEnabledExtensionNames = eng::device_extensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+    createInfo.ppEnabledExtensionNames = enabled_extensions.data();
 
     if (debug_layers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(eng::validation_layers.size());
@@ -119,26 +133,34 @@ eng::result<eng::device::queue_family_indices> eng::device::find_queue_families(
     std::vector<VkQueueFamilyProperties> queue_family_properties(queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_family_properties.data());
 
-    int index = 0;
+    uint32_t index = 0;
     for (const VkQueueFamilyProperties& queue_family : queue_family_properties) {
-        if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphics_family.has_value()) {
             indices.graphics_family = index;
         }
 
-        VkBool32 present_support = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, index, surface, &present_support);
-
-        if (present_support) {
-            indices.present_family = index;
+        // a family without graphics runs compute asynchronously alongside the graphics queue
+        if ((queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.compute_family.has_value()) {
+            indices.compute_family = index;
         }
 
-        if (indices.complete()) {
-            break;
+        if (surface != VK_NULL_HANDLE) {
+            VkBool32 present_support = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, index, surface, &present_support);
+
+            if (present_support && !indices.present_family.has_value()) {
+                indices.present_family = index;
+            }
         }
 
         ++index;
     }
 
+    if (!indices.compute_family.has_value() && indices.graphics_family.has_value()
+        && (queue_family_properties[indices.graphics_family.value()].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+        indices.compute_family = indices.graphics_family;
+    }
+
     return eng::result<eng::device::queue_family_indices>::success(indices);
 }
 
@@ -159,6 +181,10 @@ bool eng::device::is_device_suitable(VkPhysicalDevice physical_device, VkSurface
         return false;
     }
 
+    if (surface == VK_NULL_HANDLE) {
+        return indices.unwrap().complete();
+    }
+
     bool extensions_supported = check_device_extension_support(physical_device);
     bool swap_chain_adequate = false;
 
@@ -171,7 +197,8 @@ bool eng::device::is_device_suitable(VkPhysicalDevice physical_device, VkSurface
     return physical_device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
         && swap_chain_adequate
         && physical_device_features.geometryShader
-        && indices.unwrap().complete();
+        && indices.unwrap().complete()
+        && indices.unwrap().present_family.has_value();
 }
 
 bool eng::device::check_device_extension_support(VkPhysicalDevice physical_device) {
@@ -194,6 +221,100 @@ bool eng::device::check_device_extension_support(VkPhysicalDevice physical_devic
     return required_extensions.empty();
 }
 
+bool eng::device::check_device_extension_support(VkPhysicalDevice physical_device, const char* extension_name) {
+    if (physical_device == VK_NULL_HANDLE) {
+        throw std::invalid_argument("Invalid Vulkan instance.");
+    }
+
+    uint32_t extension_count;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, available_extensions.data());
+
+    for (const VkExtensionProperties& extension : available_extensions) {
+        if (strcmp(extension.extensionName, extension_name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+eng::device::features eng::device::query_supported_features(VkPhysicalDevice physical_device) {
+    if (physical_device == VK_NULL_HANDLE) {
+        throw std::invalid_argument("Invalid Vulkan instance.");
+    }
+
+    VkPhysicalDeviceFeatures physical_device_features;
+    vkGetPhysicalDeviceFeatures(physical_device, &physical_device_features);
+
+    eng::device::features supported_features;
+    supported_features.multi_draw_indirect = physical_device_features.multiDrawIndirect == VK_TRUE;
+    supported_features.draw_indirect_first_instance = physical_device_features.drawIndirectFirstInstance == VK_TRUE;
+    supported_features.draw_indirect_count = check_device_extension_support(physical_device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    supported_features.memory_budget = check_device_extension_support(physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    return supported_features;
+}
+
+eng::result<uint32_t> eng::device::find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) const {
+    if (physical_device_handle == VK_NULL_HANDLE) {
+        return eng::result<uint32_t>::error("Invalid Vulkan physical device.");
+    }
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device_handle, &memory_properties);
+
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+        if ((type_filter & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return eng::result<uint32_t>::success(i);
+        }
+    }
+
+    return eng::result<uint32_t>::error("Failed to find suitable memory type.");
+}
+
+std::vector<eng::device::heap_budget> eng::device::query_memory_budget() const {
+    std::vector<eng::device::heap_budget> budgets;
+    query_memory_budget(budgets);
+
+    return budgets;
+}
+
+void eng::device::query_memory_budget(std::vector<eng::device::heap_budget>& budgets) const {
+    if (physical_device_handle == VK_NULL_HANDLE) {
+        throw std::logic_error("Called query_memory_budget on an invalid device.");
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2KHR memory_properties{};
+    memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+
+    bool has_budget = enabled_features.memory_budget && get_memory_properties2 != nullptr;
+
+    if (has_budget) {
+        memory_properties.pNext = &budget_properties;
+        get_memory_properties2(physical_device_handle, &memory_properties);
+    }
+    else {
+        vkGetPhysicalDeviceMemoryProperties(physical_device_handle, &memory_properties.memoryProperties);
+    }
+
+    budgets.resize(memory_properties.memoryProperties.memoryHeapCount);
+
+    for (uint32_t i = 0; i < memory_properties.memoryProperties.memoryHeapCount; ++i) {
+        const VkMemoryHeap& heap = memory_properties.memoryProperties.memoryHeaps[i];
+
+        budgets[i].size = heap.size;
+        budgets[i].budget = has_budget ? budget_properties.heapBudget[i] : heap.size / 10 * 8;
+        budgets[i].usage = has_budget ? budget_properties.heapUsage[i] : 0;
+        budgets[i].device_local = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+}
+
 int eng::device::rate_device_suitability(VkPhysicalDevice physical_device) {
     if (physical_device == VK_NULL_HANDLE) {
         throw std::invalid_argument("Invalid Vulkan instance.");
@@ -220,12 +341,29 @@ int eng::device::rate_device_suitability(VkPhysicalDevice physical_device) {
     return score;
 }
 
-eng::device::device() : logical_device_handle(VK_NULL_HANDLE) {}
-
-eng::device::device(VkDevice logical_device_handle, VkQueue present_queue_handle, VkSwapchainKHR swap_chain_handle) 
-    : logical_device_handle(logical_device_handle),
+eng::device::device()
+    : physical_device_handle(VK_NULL_HANDLE),
+    logical_device_handle(VK_NULL_HANDLE),
+    graphics_queue_handle(VK_NULL_HANDLE),
+    graphics_queue_family(0),
+    compute_queue_handle(VK_NULL_HANDLE),
+    compute_queue_family(0),
+    present_queue_handle(VK_NULL_HANDLE),
+    swap_chain_handle(VK_NULL_HANDLE),
+    enabled_features(),
+    get_memory_properties2(nullptr) {}
+
+eng::device::device(VkPhysicalDevice physical_device_handle, VkDevice logical_device_handle, VkQueue graphics_queue_handle, uint32_t graphics_queue_family, VkQueue compute_queue_handle, uint32_t compute_queue_family, VkQueue present_queue_handle, VkSwapchainKHR swap_chain_handle, features enabled_features, PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2)
+    : physical_device_handle(physical_device_handle),
+    logical_device_handle(logical_device_handle),
+    graphics_queue_handle(graphics_queue_handle),
+    graphics_queue_family(graphics_queue_family),
+    compute_queue_handle(compute_queue_handle),
+    compute_queue_family(compute_queue_family),
     present_queue_handle(present_queue_handle),
-    swap_chain_handle(swap_chain_handle) {}
+    swap_chain_handle(swap_chain_handle),
+    enabled_features(enabled_features),
+    get_memory_properties2(get_memory_properties2) {}
 
 eng::device::~device() {
     if (logical_device_handle != VK_NULL_HANDLE) {
@@ -238,17 +376,37 @@ eng::device::~device() {
 }
 
 eng::device::device(eng::device&& other) noexcept
-    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
-    present_queue_handle(std::exchange(other.present_queue_handle, VK_NULL_HANDLE)){}
+    : physical_device_handle(std::exchange(other.physical_device_handle, VK_NULL_HANDLE)),
+    logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    graphics_queue_handle(std::exchange(other.graphics_queue_handle, VK_NULL_HANDLE)),
+    graphics_queue_family(other.graphics_queue_family),
+    compute_queue_handle(std::exchange(other.compute_queue_handle, VK_NULL_HANDLE)),
+    compute_queue_family(other.compute_queue_family),
+    present_queue_handle(std::exchange(other.present_queue_handle, VK_NULL_HANDLE)),
+    swap_chain_handle(std::exchange(other.swap_chain_handle, VK_NULL_HANDLE)),
+    enabled_features(other.enabled_features),
+    get_memory_properties2(std::exchange(other.get_memory_properties2, nullptr)) {}
 
 eng::device& eng::device::operator=(eng::device&& other) noexcept {
     if (this != &other) {
         if (logical_device_handle != VK_NULL_HANDLE) {
+            if (swap_chain_handle != VK_NULL_HANDLE) {
+                vkDestroySwapchainKHR(logical_device_handle, swap_chain_handle, nullptr);
+            }
+
             vkDestroyDevice(logical_device_handle, nullptr);
         }
 
+        physical_device_handle = std::exchange(other.physical_device_handle, VK_NULL_HANDLE);
         logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        graphics_queue_handle = std::exchange(other.graphics_queue_handle, VK_NULL_HANDLE);
+        graphics_queue_family = other.graphics_queue_family;
+        compute_queue_handle = std::exchange(other.compute_queue_handle, VK_NULL_HANDLE);
+        compute_queue_family = other.compute_queue_family;
         present_queue_handle = std::exchange(other.present_queue_handle, VK_NULL_HANDLE);
+        swap_chain_handle = std::exchange(other.swap_chain_handle, VK_NULL_HANDLE);
+        enabled_features = other.enabled_features;
+        get_memory_properties2 = std::exchange(other.get_memory_properties2, nullptr);
     }
 
     return *this;
@@ -259,12 +417,12 @@ eng::result<eng::device> eng::device::create_device(eng::instance& instance, GLF
         return eng::result<eng::device>::error("Invalid instance.");
     }
 
-    if (window == nullptr) {
-        return eng::result<eng::device>::error("Invalid window.");
-    }
-
     VkInstance instance_handle = instance.get_vulkan_instance();
-    VkSurfaceKHR surface_handle = instance.get_vulkan_surface();
+    VkSurfaceKHR surface_handle = window != nullptr ? instance.get_vulkan_surface() : VK_NULL_HANDLE;
+
+    if (window != nullptr && surface_handle == VK_NULL_HANDLE) {
+        return eng::result<eng::device>::error("Instance was created without a surface.");
+    }
 
     eng::result<VkPhysicalDevice> physical_device_result = pick_physical_device(instance_handle, surface_handle);
 
@@ -274,7 +432,18 @@ eng::result<eng::device> eng::device::create_device(eng::instance& instance, GLF
 
     VkPhysicalDevice physical_device = physical_device_result.unwrap();
 
-    eng::result<VkDevice> logical_device_result = create_logical_device(physical_device, surface_handle, debug_layers);
+    eng::device::features enabled_features = query_supported_features(physical_device);
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties2 = nullptr;
+
+    if (enabled_features.memory_budget && instance.supports_physical_device_properties2()) {
+        get_memory_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(instance_handle, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+    }
+
+    // the budget extension is useless without a way to query it
+    enabled_features.memory_budget = get_memory_properties2 != nullptr;
+
+    eng::result<VkDevice> logical_device_result = create_logical_device(physical_device, surface_handle, enabled_features, debug_layers);
 
     if (logical_device_result.is_error()) {
         return eng::result<eng::device>::error(logical_device_result.error_message());
@@ -292,18 +461,29 @@ eng::result<eng::device> eng::device::create_device(eng::instance& instance, GLF
 
     eng::device::queue_family_indices indices = indices_result.unwrap();
 
-    VkQueue present_queue;
-    vkGetDeviceQueue(logical_device, indices.present_family.value(), 0, &present_queue);
+    VkQueue graphics_queue;
+    vkGetDeviceQueue(logical_device, indices.graphics_family.value(), 0, &graphics_queue);
 
-    eng::result<VkSwapchainKHR> swap_chain_result = create_swap_chain(physical_device, logical_device, surface_handle, window);
+    VkQueue compute_queue;
+    vkGetDeviceQueue(logical_device, indices.compute_family.value(), 0, &compute_queue);
 
-    if (swap_chain_result.is_error()) {
-        return eng::result<eng::device>::error(swap_chain_result.error_message());
-    }
+    VkQueue present_queue = VK_NULL_HANDLE;
+    VkSwapchainKHR swap_chain = VK_NULL_HANDLE;
 
-    VkSwapchainKHR swap_chain = swap_chain_result.unwrap();
+    if (surface_handle != VK_NULL_HANDLE) {
+        vkGetDeviceQueue(logical_device, indices.present_family.value(), 0, &present_queue);
+
+        eng::result<VkSwapchainKHR> swap_chain_result = create_swap_chain(physical_device, logical_device, surface_handle, window);
+
+        if (swap_chain_result.is_error()) {
+            return eng::result<eng::device>::error(swap_chain_result.error_message());
+        }
+
+        swap_chain = swap_chain_result.unwrap();
+    }
 
-    return eng::result<eng::device>::success(device(logical_device, present_queue, swap_chain));
+    return eng::result<eng::device>::success(device(physical_device, logical_device, graphics_queue, indices.graphics_family.value(),
+        compute_queue, indices.compute_family.value(), present_queue, swap_chain, enabled_features, get_memory_properties2));
 }
 
 eng::device::swap_chain_support_details eng::device::query_swap_chain_support(VkPhysicalDevice physical_device, VkSurfaceKHR surface) {
@@ -0,0 +1,422 @@
+#include "../include/draw_queue.hpp"
+#include "../include/capture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    class sort_barrier {
+    public:
+        explicit sort_barrier(unsigned thread_count) : thread_count(thread_count), waiting(0), generation(0) {}
+
+        void arrive_and_wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            unsigned current_generation = generation;
+
+            if (++waiting == thread_count) {
+                waiting = 0;
+                ++generation;
+                condition.notify_all();
+
+                return;
+            }
+
+            condition.wait(lock, [&] { return generation != current_generation; });
+        }
+    private:
+        std::mutex mutex;
+        std::condition_variable condition;
+        unsigned thread_count;
+        unsigned waiting;
+        unsigned generation;
+    };
+}
+
+// threads are started once and parked between sorts, so a build doesn't create or join any
+class eng::draw_queue::worker_pool {
+public:
+    using job = void (*)(void* context, unsigned thread_index);
+
+    explicit worker_pool(unsigned worker_count) : current_job(nullptr), current_context(nullptr), generation(0), remaining(0), stopping(false) {
+        threads.reserve(worker_count);
+
+        for (unsigned i = 0; i < worker_count; ++i) {
+            threads.emplace_back([this, i] { run_worker(i + 1); });
+        }
+    }
+
+    ~worker_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        start_condition.notify_all();
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // calls work with thread indices 1 to worker_count on the pool and 0 on the calling thread, then waits for all of them
+    void run(job work, void* context) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            current_job = work;
+            current_context = context;
+            remaining = static_cast<unsigned>(threads.size());
+            ++generation;
+        }
+
+        start_condition.notify_all();
+
+        work(context, 0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done_condition.wait(lock, [this] { return remaining == 0; });
+    }
+private:
+    void run_worker(unsigned thread_index) {
+        uint64_t seen_generation = 0;
+
+        while (true) {
+            job work;
+            void* context;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_condition.wait(lock, [&] { return stopping || generation != seen_generation; });
+
+                if (stopping) {
+                    return;
+                }
+
+                seen_generation = generation;
+                work = current_job;
+                context = current_context;
+            }
+
+            work(context, thread_index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (--remaining == 0) {
+                done_condition.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    job current_job;
+    void* current_context;
+    uint64_t generation;
+    unsigned remaining;
+    bool stopping;
+};
+
+uint64_t eng::draw_queue::make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+    if (pass >= (1u << pass_bits) || pipeline >= (1u << pipeline_bits) || material >= (1u << material_bits) || mesh >= (1u << mesh_bits)) {
+        throw std::invalid_argument("Sort key field out of range.");
+    }
+
+    float clamped_depth = std::min(std::max(depth, 0.0f), 1.0f);
+    uint64_t quantized_depth = static_cast<uint64_t>(clamped_depth * static_cast<float>((1u << depth_bits) - 1));
+
+    return (static_cast<uint64_t>(pass) << pass_shift)
+        | (static_cast<uint64_t>(pipeline) << pipeline_shift)
+        | (static_cast<uint64_t>(material) << material_shift)
+        | (static_cast<uint64_t>(mesh) << mesh_shift)
+        | (quantized_depth << depth_shift);
+}
+
+eng::draw_queue::draw_queue(unsigned thread_count)
+    : thread_count(thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency())),
+    frame_statistics() {}
+
+eng::draw_queue::~draw_queue() = default;
+
+eng::draw_queue::draw_queue(eng::draw_queue&& other) noexcept = default;
+
+eng::draw_queue& eng::draw_queue::operator=(eng::draw_queue&& other) noexcept = default;
+
+uint32_t eng::draw_queue::register_pipeline(VkPipeline pipeline, VkPipelineLayout pipeline_layout) {
+    if (pipelines.size() >= (1u << pipeline_bits)) {
+        throw std::length_error("Too many pipelines registered with draw queue.");
+    }
+
+    pipelines.push_back({ pipeline, pipeline_layout });
+
+    return static_cast<uint32_t>(pipelines.size() - 1);
+}
+
+uint32_t eng::draw_queue::register_material(VkDescriptorSet descriptor_set, uint32_t set_index) {
+    if (materials.size() >= (1u << material_bits)) {
+        throw std::length_error("Too many materials registered with draw queue.");
+    }
+
+    materials.push_back({ descriptor_set, set_index });
+
+    return static_cast<uint32_t>(materials.size() - 1);
+}
+
+uint32_t eng::draw_queue::register_mesh(const eng::draw_queue::mesh& mesh) {
+    if (meshes.size() >= (1u << mesh_bits)) {
+        throw std::length_error("Too many meshes registered with draw queue.");
+    }
+
+    meshes.push_back(mesh);
+
+    return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void eng::draw_queue::begin_frame() {
+    entries.clear();
+    batches.clear();
+    instance_indices.clear();
+
+    frame_statistics = statistics();
+}
+
+void eng::draw_queue::submit(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth, uint32_t instance_data_index) {
+    if (pipeline >= pipelines.size() || material >= materials.size() || mesh >= meshes.size()) {
+        throw std::invalid_argument("Draw references an unregistered pipeline, material or mesh.");
+    }
+
+    entries.push_back({ make_key(pass, pipeline, material, mesh, depth), instance_data_index });
+}
+
+void eng::draw_queue::build(std::pmr::memory_resource* resource) {
+    frame_statistics.submitted_draws = static_cast<uint32_t>(entries.size());
+
+    count_unsorted_binds();
+
+    radix_sort(resource);
+
+    batches.clear();
+    instance_indices.clear();
+    instance_indices.reserve(entries.size());
+
+    // draws that only differ in depth share all state and can become one instanced draw
+    constexpr uint64_t state_mask = ~((1ull << mesh_shift) - 1);
+
+    for (const sort_entry& entry : entries) {
+        uint32_t instance = static_cast<uint32_t>(instance_indices.size());
+
+        instance_indices.push_back(entry.instance_data_index);
+
+        if (batches.empty() || (batches.back().key & state_mask) != (entry.key & state_mask)) {
+            batches.push_back({ entry.key, instance, 1 });
+        }
+        else {
+            ++batches.back().instance_count;
+        }
+    }
+
+    frame_statistics.recorded_draws = static_cast<uint32_t>(batches.size());
+    frame_statistics.draws_saved = frame_statistics.submitted_draws - frame_statistics.recorded_draws;
+}
+
+void eng::draw_queue::record(VkCommandBuffer command_buffer, uint32_t pass) {
+    std::vector<batch>::const_iterator current = std::lower_bound(batches.begin(), batches.end(), static_cast<uint64_t>(pass) << pass_shift,
+        [](const batch& batch, uint64_t key) { return batch.key < key; });
+
+    constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    uint32_t bound_pipeline = none;
+    uint32_t bound_material = none;
+    VkPipelineLayout bound_pipeline_layout = VK_NULL_HANDLE;
+    const mesh* bound_vertex_mesh = nullptr;
+    const mesh* bound_index_mesh = nullptr;
+    uint32_t draws = 0;
+
+    for (; current != batches.end() && key_field(current->key, pass_shift, pass_bits) == pass; ++current) {
+        uint32_t pipeline_id = key_field(current->key, pipeline_shift, pipeline_bits);
+        uint32_t material_id = key_field(current->key, material_shift, material_bits);
+        const mesh& batch_mesh = meshes[key_field(current->key, mesh_shift, mesh_bits)];
+
+        if (pipeline_id != bound_pipeline) {
+            const pipeline_entry& pipeline = pipelines[pipeline_id];
+
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+            ++frame_statistics.pipeline_binds;
+
+            // descriptor sets only survive a pipeline change when the layouts match
+            if (pipeline.pipeline_layout != bound_pipeline_layout) {
+                bound_material = none;
+                bound_pipeline_layout = pipeline.pipeline_layout;
+            }
+
+            bound_pipeline = pipeline_id;
+        }
+
+        if (material_id != bound_material) {
+            const material_entry& material = materials[material_id];
+
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bound_pipeline_layout, material.set_index, 1, &material.descriptor_set, 0, nullptr);
+            ++frame_statistics.descriptor_binds;
+
+            bound_material = material_id;
+        }
+
+        if (bound_vertex_mesh == nullptr
+            || bound_vertex_mesh->vertex_buffer != batch_mesh.vertex_buffer
+            || bound_vertex_mesh->vertex_buffer_offset != batch_mesh.vertex_buffer_offset) {
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, &batch_mesh.vertex_buffer, &batch_mesh.vertex_buffer_offset);
+            ++frame_statistics.vertex_buffer_binds;
+
+            bound_vertex_mesh = &batch_mesh;
+        }
+
+        if (bound_index_mesh == nullptr
+            || bound_index_mesh->index_buffer != batch_mesh.index_buffer
+            || bound_index_mesh->index_buffer_offset != batch_mesh.index_buffer_offset
+            || bound_index_mesh->index_type != batch_mesh.index_type) {
+            vkCmdBindIndexBuffer(command_buffer, batch_mesh.index_buffer, batch_mesh.index_buffer_offset, batch_mesh.index_type);
+            ++frame_statistics.index_buffer_binds;
+
+            bound_index_mesh = &batch_mesh;
+        }
+
+        vkCmdDrawIndexed(command_buffer, batch_mesh.index_count, current->instance_count, batch_mesh.first_index, batch_mesh.vertex_offset, current->first_instance);
+        ++draws;
+    }
+
+    eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::draw, draws);
+}
+
+void eng::draw_queue::count_unsorted_binds() {
+    constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    uint32_t bound_pipeline = none;
+    uint32_t bound_material = none;
+    const mesh* bound_mesh = nullptr;
+
+    for (const sort_entry& entry : entries) {
+        uint32_t pipeline_id = key_field(entry.key, pipeline_shift, pipeline_bits);
+        uint32_t material_id = key_field(entry.key, material_shift, material_bits);
+        const mesh* entry_mesh = &meshes[key_field(entry.key, mesh_shift, mesh_bits)];
+
+        if (pipeline_id != bound_pipeline) {
+            ++frame_statistics.unsorted_pipeline_binds;
+            bound_pipeline = pipeline_id;
+        }
+
+        if (material_id != bound_material) {
+            ++frame_statistics.unsorted_descriptor_binds;
+            bound_material = material_id;
+        }
+
+        if (bound_mesh == nullptr || bound_mesh->vertex_buffer != entry_mesh->vertex_buffer || bound_mesh->vertex_buffer_offset != entry_mesh->vertex_buffer_offset) {
+            ++frame_statistics.unsorted_vertex_buffer_binds;
+            bound_mesh = entry_mesh;
+        }
+    }
+}
+
+// stable least significant digit radix sort, 8 bits per pass. every thread histograms and scatters
+// its own contiguous slice, and passes where all keys share a digit are skipped entirely
+void eng::draw_queue::radix_sort(std::pmr::memory_resource* resource) {
+    constexpr uint32_t radix_bits = 8;
+    constexpr uint32_t bucket_count = 1u << radix_bits;
+    constexpr uint32_t pass_count = 64 / radix_bits;
+
+    size_t count = entries.size();
+
+    if (count < 2) {
+        return;
+    }
+
+    unsigned thread_count = count < parallel_sort_threshold ? 1 : this->thread_count;
+
+    if (thread_count > 1 && !workers) {
+        workers = std::make_unique<worker_pool>(thread_count - 1);
+    }
+
+    scratch.resize(count);
+
+    std::pmr::vector<std::array<size_t, bucket_count>> histograms(thread_count, resource);
+    sort_barrier barrier(thread_count);
+
+    sort_entry* final_entries = nullptr;
+
+    auto worker = [&](unsigned thread_index) {
+        size_t begin = count * thread_index / thread_count;
+        size_t end = count * (thread_index + 1) / thread_count;
+
+        sort_entry* source = entries.data();
+        sort_entry* destination = scratch.data();
+
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            uint32_t shift = pass * radix_bits;
+
+            std::array<size_t, bucket_count>& histogram = histograms[thread_index];
+            histogram.fill(0);
+
+            for (size_t i = begin; i < end; ++i) {
+                ++histogram[(source[i].key >> shift) & (bucket_count - 1)];
+            }
+
+            barrier.arrive_and_wait();
+
+            std::array<size_t, bucket_count> offsets{};
+            size_t running_total = 0;
+            bool skip_pass = false;
+
+            for (uint32_t bucket = 0; bucket < bucket_count; ++bucket) {
+                size_t bucket_total = 0;
+
+                for (unsigned thread = 0; thread < thread_count; ++thread) {
+                    if (thread == thread_index) {
+                        offsets[bucket] = running_total + bucket_total;
+                    }
+
+                    bucket_total += histograms[thread][bucket];
+                }
+
+                if (bucket_total == count) {
+                    skip_pass = true;
+                }
+
+                running_total += bucket_total;
+            }
+
+            if (!skip_pass) {
+                for (size_t i = begin; i < end; ++i) {
+                    destination[offsets[(source[i].key >> shift) & (bucket_count - 1)]++] = source[i];
+                }
+            }
+
+            // the histograms are rewritten next pass and the scatter has to finish before anyone reads it
+            barrier.arrive_and_wait();
+
+            if (!skip_pass) {
+                std::swap(source, destination);
+            }
+        }
+
+        if (thread_index == 0) {
+            final_entries = source;
+        }
+    };
+
+    if (thread_count > 1) {
+        workers->run([](void* context, unsigned thread_index) { (*static_cast<decltype(worker)*>(context))(thread_index); }, &worker);
+    }
+    else {
+        worker(0);
+    }
+
+    if (final_entries != entries.data()) {
+        entries.swap(scratch);
+    }
+}
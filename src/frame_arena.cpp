@@ -0,0 +1,186 @@
+#include "../include/frame_arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+std::atomic<uint64_t> eng::frame_allocator::next_id{ 1 };
+
+eng::frame_arena::frame_arena(size_t block_size, std::pmr::memory_resource* upstream)
+    : upstream(upstream),
+    block_size(block_size),
+    current_block(0),
+    offset(0),
+    used(0),
+    high_water(0),
+    allocation_count(0),
+    upstream_allocations(0) {
+    if (upstream == nullptr) {
+        throw std::invalid_argument("Frame arena needs an upstream memory resource.");
+    }
+
+    if (block_size == 0) {
+        throw std::invalid_argument("Frame arena block size must be greater than zero.");
+    }
+}
+
+eng::frame_arena::~frame_arena() {
+    release_blocks();
+}
+
+void eng::frame_arena::reset() {
+#if ENG_FRAME_ARENA_POISON
+    for (size_t i = 0; i < blocks.size() && i <= current_block; ++i) {
+        std::memset(blocks[i].data, released_poison, i == current_block ? offset : blocks[i].size);
+    }
+#endif
+
+    if (blocks.size() > 1) {
+        size_t total_size = 0;
+
+        for (const block& block : blocks) {
+            total_size += block.size;
+        }
+
+        release_blocks();
+        add_block(total_size);
+    }
+
+    current_block = 0;
+    offset = 0;
+    used = 0;
+    allocation_count = 0;
+}
+
+eng::frame_arena::statistics eng::frame_arena::get_statistics() const {
+    statistics stats{};
+    stats.used = used;
+    stats.high_water = high_water;
+    stats.block_count = blocks.size();
+    stats.allocation_count = allocation_count;
+    stats.upstream_allocations = upstream_allocations;
+
+    for (const block& block : blocks) {
+        stats.capacity += block.size;
+    }
+
+    return stats;
+}
+
+void* eng::frame_arena::do_allocate(size_t bytes, size_t alignment) {
+    bytes = std::max<size_t>(bytes, 1);
+
+    while (true) {
+        if (current_block < blocks.size()) {
+            block& block = blocks[current_block];
+
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+            size_t aligned_offset = static_cast<size_t>((base + offset + alignment - 1) / alignment * alignment - base);
+
+            if (aligned_offset <= block.size && bytes <= block.size - aligned_offset) {
+                used += aligned_offset - offset + bytes;
+                offset = aligned_offset + bytes;
+                high_water = std::max(high_water, used);
+                ++allocation_count;
+
+#if ENG_FRAME_ARENA_POISON
+                std::memset(block.data + aligned_offset, allocated_poison, bytes);
+#endif
+
+                return block.data + aligned_offset;
+            }
+
+            // blocks kept from earlier frames are reused before asking upstream for more
+            if (current_block + 1 < blocks.size()) {
+                ++current_block;
+                offset = 0;
+                continue;
+            }
+        }
+
+        add_block(bytes + alignment);
+        current_block = blocks.size() - 1;
+        offset = 0;
+    }
+}
+
+void eng::frame_arena::do_deallocate(void*, size_t, size_t) {}
+
+bool eng::frame_arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void eng::frame_arena::add_block(size_t minimum_size) {
+    size_t size = std::max(block_size, minimum_size);
+
+    blocks.push_back({ static_cast<unsigned char*>(upstream->allocate(size, alignof(std::max_align_t))), size });
+    ++upstream_allocations;
+}
+
+void eng::frame_arena::release_blocks() {
+    for (const block& block : blocks) {
+        upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+    }
+
+    blocks.clear();
+}
+
+eng::frame_allocator::frame_allocator(size_t block_size)
+    : block_size(block_size),
+    id(next_id++),
+    frame_index(0) {}
+
+void eng::frame_allocator::begin_frame() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& [thread_id, arena] : arenas) {
+        arena->reset();
+    }
+
+    ++frame_index;
+}
+
+eng::frame_arena& eng::frame_allocator::get_thread_arena() {
+    // ids are never reused, so a cached arena can't belong to a destroyed allocator at the same address
+    struct cached_arena {
+        uint64_t owner_id;
+        frame_arena* arena;
+    };
+
+    thread_local cached_arena cache{ 0, nullptr };
+
+    if (cache.owner_id == id) {
+        return *cache.arena;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unique_ptr<frame_arena>& arena = arenas[std::this_thread::get_id()];
+
+    if (arena == nullptr) {
+        arena = std::make_unique<frame_arena>(block_size);
+    }
+
+    cache = { id, arena.get() };
+
+    return *arena;
+}
+
+eng::frame_allocator::statistics eng::frame_allocator::get_statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    statistics stats{};
+    stats.thread_count = arenas.size();
+
+    for (const auto& [thread_id, arena] : arenas) {
+        frame_arena::statistics arena_stats = arena->get_statistics();
+
+        stats.used += arena_stats.used;
+        stats.high_water += arena_stats.high_water;
+        stats.capacity += arena_stats.capacity;
+        stats.allocation_count += arena_stats.allocation_count;
+        stats.upstream_allocations += arena_stats.upstream_allocations;
+    }
+
+    return stats;
+}
@@ -0,0 +1,432 @@
+#include "../include/gpu_culling.hpp"
+#include "../include/capture.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(eng::gpu_culling::draw_item) == 48, "draw_item must match the std430 layout in cull.glsl");
+static_assert(sizeof(VkDrawIndexedIndirectCommand) == 20, "cull.glsl writes tightly packed indirect commands");
+
+eng::result<eng::gpu_culling> eng::gpu_culling::create_gpu_culling(const eng::device& device, uint32_t max_items, const char* shader_path, const char* occlusion_shader_path) {
+    if (!device.valid()) {
+        return eng::result<eng::gpu_culling>::error("Invalid device.");
+    }
+
+    if (max_items == 0) {
+        return eng::result<eng::gpu_culling>::error("Max items must be greater than zero.");
+    }
+
+    const eng::device::features& features = device.get_features();
+
+    if (!features.draw_indirect_first_instance) {
+        return eng::result<eng::gpu_culling>::error("Device does not support drawIndirectFirstInstance.");
+    }
+
+    eng::gpu_culling culling;
+    culling.max_items = max_items;
+
+    if (features.draw_indirect_count) {
+        culling.draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device.get_vulkan_logical_device(), "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+
+    if (culling.draw_indexed_indirect_count != nullptr) {
+        culling.path = draw_path::indirect_count;
+    }
+    else if (features.multi_draw_indirect) {
+        culling.path = draw_path::multi_draw_indirect;
+    }
+    else {
+        culling.path = draw_path::single_draw_indirect;
+    }
+
+    eng::result<eng::buffer> item_buffer_result = eng::buffer::create_buffer(device, sizeof(draw_item) * max_items,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (item_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(item_buffer_result.error_message());
+    }
+
+    culling.item_buffer = std::move(item_buffer_result.unwrap());
+
+    eng::result<eng::buffer> command_buffer_result = eng::buffer::create_buffer(device, sizeof(VkDrawIndexedIndirectCommand) * max_items,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (command_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(command_buffer_result.error_message());
+    }
+
+    culling.draw_command_buffer = std::move(command_buffer_result.unwrap());
+
+    eng::result<eng::buffer> count_buffer_result = eng::buffer::create_buffer(device, sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (count_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(count_buffer_result.error_message());
+    }
+
+    culling.count_buffer = std::move(count_buffer_result.unwrap());
+
+    eng::result<eng::buffer> parameter_buffer_result = eng::buffer::create_buffer(device, sizeof(cull_parameters),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (parameter_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(parameter_buffer_result.error_message());
+    }
+
+    culling.parameter_buffer = std::move(parameter_buffer_result.unwrap());
+
+    eng::result<eng::buffer> visibility_buffer_result = eng::buffer::create_buffer(device, sizeof(uint32_t) * max_items,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (visibility_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(visibility_buffer_result.error_message());
+    }
+
+    culling.visibility_buffer = std::move(visibility_buffer_result.unwrap());
+
+    eng::result<eng::buffer> statistics_buffer_result = eng::buffer::create_buffer(device, sizeof(statistics),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (statistics_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(statistics_buffer_result.error_message());
+    }
+
+    culling.statistics_buffer = std::move(statistics_buffer_result.unwrap());
+
+    eng::result<eng::buffer> statistics_readback_buffer_result = eng::buffer::create_buffer(device, sizeof(statistics),
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (statistics_readback_buffer_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(statistics_readback_buffer_result.error_message());
+    }
+
+    culling.statistics_readback_buffer = std::move(statistics_readback_buffer_result.unwrap());
+
+    statistics empty_statistics{};
+    culling.statistics_readback_buffer.write(&empty_statistics, sizeof(statistics));
+
+    std::vector<eng::descriptor_layout::binding> bindings;
+
+    for (uint32_t i = item_binding; i <= statistics_binding; ++i) {
+        bindings.push_back({ i, i == parameter_binding ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER });
+    }
+
+    eng::result<eng::descriptor_layout> cull_layout_result = eng::descriptor_layout::create_descriptor_layout(device, bindings);
+
+    if (cull_layout_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(cull_layout_result.error_message());
+    }
+
+    culling.cull_layout = std::move(cull_layout_result.unwrap());
+
+    eng::result<eng::descriptor_layout> pyramid_layout_result = eng::descriptor_layout::create_descriptor_layout(device,
+        { { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER } });
+
+    if (pyramid_layout_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(pyramid_layout_result.error_message());
+    }
+
+    culling.pyramid_layout = std::move(pyramid_layout_result.unwrap());
+
+    eng::result<VkDescriptorSet> cull_set_result = culling.cull_layout.allocate_set();
+
+    if (cull_set_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(cull_set_result.error_message());
+    }
+
+    culling.cull_set = cull_set_result.unwrap();
+
+    eng::result<VkDescriptorSet> pyramid_set_result = culling.pyramid_layout.allocate_set();
+
+    if (pyramid_set_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(pyramid_set_result.error_message());
+    }
+
+    culling.pyramid_set = pyramid_set_result.unwrap();
+
+    eng::descriptor_writer writer;
+
+    writer.write_storage_buffer(culling.cull_set, item_binding, culling.item_buffer)
+        .write_storage_buffer(culling.cull_set, draw_command_binding, culling.draw_command_buffer)
+        .write_storage_buffer(culling.cull_set, count_binding, culling.count_buffer)
+        .write_uniform_buffer(culling.cull_set, parameter_binding, culling.parameter_buffer)
+        .write_storage_buffer(culling.cull_set, visibility_binding, culling.visibility_buffer)
+        .write_storage_buffer(culling.cull_set, statistics_binding, culling.statistics_buffer)
+        .update(device);
+
+    VkDescriptorSetLayout cull_set_layout = culling.cull_layout.get_vulkan_descriptor_set_layout();
+    VkDescriptorSetLayout pyramid_set_layout = culling.pyramid_layout.get_vulkan_descriptor_set_layout();
+
+    eng::result<eng::compute_pipeline> pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, shader_path, { cull_set_layout });
+
+    if (pipeline_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(pipeline_result.error_message());
+    }
+
+    culling.cull_pipeline = std::move(pipeline_result.unwrap());
+
+    eng::result<eng::compute_pipeline> occlusion_pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, occlusion_shader_path,
+        { cull_set_layout, pyramid_set_layout });
+
+    if (occlusion_pipeline_result.is_error()) {
+        return eng::result<eng::gpu_culling>::error(occlusion_pipeline_result.error_message());
+    }
+
+    culling.occlusion_pipeline = std::move(occlusion_pipeline_result.unwrap());
+
+    return eng::result<eng::gpu_culling>::success(std::move(culling));
+}
+
+std::array<glm::vec4, 6> eng::gpu_culling::extract_frustum_planes(const glm::mat4& view_projection) {
+    glm::vec4 row_x(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+    glm::vec4 row_y(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+    glm::vec4 row_z(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+    glm::vec4 row_w(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+    // vulkan clip space has depth in [0, w], so the near plane is the z row on its own
+    std::array<glm::vec4, 6> planes = {
+        row_w + row_x,
+        row_w - row_x,
+        row_w + row_y,
+        row_w - row_y,
+        row_z,
+        row_w - row_z
+    };
+
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return planes;
+}
+
+eng::gpu_culling::gpu_culling()
+    : cull_set(VK_NULL_HANDLE),
+    pyramid_set(VK_NULL_HANDLE),
+    draw_indexed_indirect_count(nullptr),
+    max_items(0),
+    item_count(0),
+    path(draw_path::single_draw_indirect),
+    reset_visibility(true),
+    has_depth_pyramid(false),
+    pyramid_reversed_z(false),
+    pyramid_size(0.0f),
+    pyramid_levels(0) {}
+
+eng::gpu_culling::gpu_culling(eng::gpu_culling&& other) noexcept
+    : cull_layout(std::move(other.cull_layout)),
+    pyramid_layout(std::move(other.pyramid_layout)),
+    cull_set(std::exchange(other.cull_set, VK_NULL_HANDLE)),
+    pyramid_set(std::exchange(other.pyramid_set, VK_NULL_HANDLE)),
+    cull_pipeline(std::move(other.cull_pipeline)),
+    occlusion_pipeline(std::move(other.occlusion_pipeline)),
+    draw_indexed_indirect_count(std::exchange(other.draw_indexed_indirect_count, nullptr)),
+    item_buffer(std::move(other.item_buffer)),
+    draw_command_buffer(std::move(other.draw_command_buffer)),
+    count_buffer(std::move(other.count_buffer)),
+    parameter_buffer(std::move(other.parameter_buffer)),
+    visibility_buffer(std::move(other.visibility_buffer)),
+    statistics_buffer(std::move(other.statistics_buffer)),
+    statistics_readback_buffer(std::move(other.statistics_readback_buffer)),
+    max_items(std::exchange(other.max_items, 0)),
+    item_count(std::exchange(other.item_count, 0)),
+    path(other.path),
+    reset_visibility(other.reset_visibility),
+    has_depth_pyramid(std::exchange(other.has_depth_pyramid, false)),
+    pyramid_reversed_z(other.pyramid_reversed_z),
+    pyramid_size(other.pyramid_size),
+    pyramid_levels(other.pyramid_levels) {}
+
+eng::gpu_culling& eng::gpu_culling::operator=(eng::gpu_culling&& other) noexcept {
+    if (this != &other) {
+        // the sets were allocated from the two layouts, which are only replaced after the pipelines that use them
+        cull_pipeline = std::move(other.cull_pipeline);
+        occlusion_pipeline = std::move(other.occlusion_pipeline);
+        cull_layout = std::move(other.cull_layout);
+        pyramid_layout = std::move(other.pyramid_layout);
+        cull_set = std::exchange(other.cull_set, VK_NULL_HANDLE);
+        pyramid_set = std::exchange(other.pyramid_set, VK_NULL_HANDLE);
+        draw_indexed_indirect_count = std::exchange(other.draw_indexed_indirect_count, nullptr);
+        item_buffer = std::move(other.item_buffer);
+        draw_command_buffer = std::move(other.draw_command_buffer);
+        count_buffer = std::move(other.count_buffer);
+        parameter_buffer = std::move(other.parameter_buffer);
+        visibility_buffer = std::move(other.visibility_buffer);
+        statistics_buffer = std::move(other.statistics_buffer);
+        statistics_readback_buffer = std::move(other.statistics_readback_buffer);
+        max_items = std::exchange(other.max_items, 0);
+        item_count = std::exchange(other.item_count, 0);
+        path = other.path;
+        reset_visibility = other.reset_visibility;
+        has_depth_pyramid = std::exchange(other.has_depth_pyramid, false);
+        pyramid_reversed_z = other.pyramid_reversed_z;
+        pyramid_size = other.pyramid_size;
+        pyramid_levels = other.pyramid_levels;
+    }
+
+    return *this;
+}
+
+void eng::gpu_culling::set_items(const std::vector<eng::gpu_culling::draw_item>& items) {
+    if (items.size() > max_items) {
+        throw std::invalid_argument("Too many draw items for culling buffer.");
+    }
+
+    if (!items.empty()) {
+        item_buffer.write(items.data(), sizeof(draw_item) * items.size());
+    }
+
+    item_count = static_cast<uint32_t>(items.size());
+
+    // last frame's visibility no longer lines up with the items, so treat everything as visible once
+    reset_visibility = true;
+}
+
+void eng::gpu_culling::set_depth_pyramid(const eng::device& device, const eng::depth_pyramid& pyramid) {
+    if (!pyramid.valid()) {
+        throw std::invalid_argument("Invalid depth pyramid.");
+    }
+
+    eng::descriptor_writer writer;
+
+    writer.write_image(pyramid_set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pyramid.get_vulkan_image_view(), pyramid.get_vulkan_sampler(), VK_IMAGE_LAYOUT_GENERAL)
+        .update(device);
+
+    has_depth_pyramid = true;
+    pyramid_reversed_z = pyramid.is_reversed_z();
+    pyramid_size = glm::vec2(static_cast<float>(pyramid.get_width()), static_cast<float>(pyramid.get_height()));
+    pyramid_levels = pyramid.get_level_count();
+}
+
+void eng::gpu_culling::record_cull(VkCommandBuffer command_buffer, const glm::mat4& view_projection, const glm::vec3& camera_position, cull_phase phase) {
+    if (phase == cull_phase::late && !has_depth_pyramid) {
+        throw std::logic_error("Called record_cull for the late phase without a depth pyramid.");
+    }
+
+    bool collect_statistics = phase != cull_phase::early;
+
+    cull_parameters parameters{};
+
+    std::array<glm::vec4, 6> planes = extract_frustum_planes(view_projection);
+
+    for (size_t i = 0; i < planes.size(); ++i) {
+        parameters.frustum_planes[i] = planes[i];
+    }
+
+    parameters.camera_position = glm::vec4(camera_position, 1.0f);
+    parameters.view_projection = view_projection;
+    parameters.pyramid_size = pyramid_size;
+    parameters.pyramid_levels = pyramid_levels;
+    parameters.item_count = item_count;
+    parameters.flags = path == draw_path::indirect_count ? flag_compact : 0;
+
+    if (phase == cull_phase::early) {
+        parameters.flags |= flag_early;
+    }
+    else if (phase == cull_phase::late) {
+        parameters.flags |= flag_late;
+    }
+
+    if (collect_statistics) {
+        parameters.flags |= flag_statistics;
+    }
+
+    if (pyramid_reversed_z) {
+        parameters.flags |= flag_reversed_z;
+    }
+
+    // the previous indirect draws and culling reads have to finish before the count and
+    // parameters are overwritten, and the compute writes must land before drawing
+    compute_pipeline::record_barrier(command_buffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    compute_pipeline::record_fill_buffer(command_buffer, count_buffer, 0);
+    compute_pipeline::record_update_buffer(command_buffer, parameter_buffer, &parameters, sizeof(cull_parameters));
+
+    if (reset_visibility) {
+        compute_pipeline::record_fill_buffer(command_buffer, visibility_buffer, 1);
+
+        reset_visibility = false;
+    }
+
+    if (collect_statistics) {
+        compute_pipeline::record_fill_buffer(command_buffer, statistics_buffer, 0);
+    }
+
+    compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_UNIFORM_READ_BIT);
+
+    if (item_count > 0) {
+        const compute_pipeline& pipeline = phase == cull_phase::late ? occlusion_pipeline : cull_pipeline;
+
+        pipeline.bind(command_buffer);
+        pipeline.bind_descriptor_set(command_buffer, 0, cull_set);
+
+        if (phase == cull_phase::late) {
+            pipeline.bind_descriptor_set(command_buffer, 1, pyramid_set);
+        }
+
+        pipeline.dispatch(command_buffer, compute_pipeline::group_count(item_count, workgroup_size));
+    }
+
+    compute_pipeline::record_barrier(command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+    if (collect_statistics) {
+        VkBufferCopy copy{};
+        copy.size = sizeof(statistics);
+
+        compute_pipeline::record_copy_buffer(command_buffer, statistics_buffer, statistics_readback_buffer, copy);
+    }
+}
+
+eng::gpu_culling::statistics eng::gpu_culling::get_statistics() const {
+    statistics result{};
+
+    if (statistics_readback_buffer.get_mapped_data() != nullptr) {
+        memcpy(&result, statistics_readback_buffer.get_mapped_data(), sizeof(statistics));
+    }
+
+    return result;
+}
+
+void eng::gpu_culling::record_draw(VkCommandBuffer command_buffer) const {
+    if (item_count == 0) {
+        return;
+    }
+
+    VkBuffer commands = draw_command_buffer.get_vulkan_buffer();
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    switch (path) {
+    case draw_path::indirect_count:
+        draw_indexed_indirect_count(command_buffer, commands, 0, count_buffer.get_vulkan_buffer(), 0, item_count, stride);
+
+        eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::draw_indirect_count);
+        break;
+    case draw_path::multi_draw_indirect:
+        vkCmdDrawIndexedIndirect(command_buffer, commands, 0, item_count, stride);
+
+        eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::draw_indirect);
+        break;
+    case draw_path::single_draw_indirect:
+        // without multiDrawIndirect the draw count must be 0 or 1, culled items carry an instance count of 0
+        for (uint32_t i = 0; i < item_count; ++i) {
+            vkCmdDrawIndexedIndirect(command_buffer, commands, static_cast<VkDeviceSize>(i) * stride, 1, stride);
+        }
+
+        eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::draw_indirect, item_count);
+        break;
+    }
+}
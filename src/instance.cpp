@@ -7,10 +7,6 @@ eng::result<eng::instance> eng::instance::create_instance(const char* applicatio
         return eng::result<eng::instance>::error("Validation layers requested but not available.");
     }
 
-    if (window == nullptr) {
-        return eng::result<eng::instance>::error("Invalid window.");
-    }
-
     VkApplicationInfo application_info{};
     application_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     application_info.pApplicationName = application_name;
@@ -19,14 +15,28 @@ eng::result<eng::instance> eng::instance::create_instance(const char* applicatio
     application_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
     application_info.apiVersion = VK_API_VERSION_1_0;
 
-    uint32_t extention_count = 0;
-    const char** extentions = glfwGetRequiredInstanceExtensions(&extention_count);
+    std::vector<const char*> enabled_extensions;
+
+    // a headless instance has no surface, so it doesn't need glfw to be initialised
+    if (window != nullptr) {
+        uint32_t extention_count = 0;
+        const char** extentions = glfwGetRequiredInstanceExtensions(&extention_count);
+
+        enabled_extensions.assign(extentions, extentions + extention_count);
+    }
+
+    // needed on a 1.0 instance to query VK_EXT_memory_budget
+    bool physical_device_properties2 = check_instance_extension_support(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
+    if (physical_device_properties2) {
+        enabled_extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
 
     VkInstanceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     create_info.pApplicationInfo = &application_info;
-    create_info.enabledExtensionCount = extention_count;
-    create_info.ppEnabledExtensionNames = extentions;
+    create_info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+    create_info.ppEnabledExtensionNames = enabled_extensions.data();
 
     if (debug_layers) {
         create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
@@ -42,19 +52,19 @@ eng::result<eng::instance> eng::instance::create_instance(const char* applicatio
     }
 
     VkSurfaceKHR surface_handle = VK_NULL_HANDLE;
-    if (glfwCreateWindowSurface(instance_handle, window, nullptr, &surface_handle) != VK_SUCCESS) {
+    if (window != nullptr && glfwCreateWindowSurface(instance_handle, window, nullptr, &surface_handle) != VK_SUCCESS) {
         vkDestroyInstance(instance_handle, nullptr);
 
         return eng::result<eng::instance>::error("Failed to create window surface.");
     }
 
-    return eng::result<eng::instance>::success(instance(instance_handle, application_info, surface_handle));
+    return eng::result<eng::instance>::success(instance(instance_handle, application_info, surface_handle, physical_device_properties2));
 }
 
-eng::instance::instance() : instance_handle(VK_NULL_HANDLE), application_info() {}
+eng::instance::instance() : instance_handle(VK_NULL_HANDLE), application_info(), surface_handle(VK_NULL_HANDLE), physical_device_properties2(false) {}
 
-eng::instance::instance(VkInstance instance_handle, VkApplicationInfo application_info, VkSurfaceKHR surface)
-    : instance_handle(instance_handle), application_info(application_info), surface_handle(surface) {}
+eng::instance::instance(VkInstance instance_handle, VkApplicationInfo application_info, VkSurfaceKHR surface, bool physical_device_properties2)
+    : instance_handle(instance_handle), application_info(application_info), surface_handle(surface), physical_device_properties2(physical_device_properties2) {}
 
 eng::instance::~instance() {
     if (instance_handle != VK_NULL_HANDLE) {
@@ -69,7 +79,8 @@ eng::instance::~instance() {
 eng::instance::instance(instance&& other) noexcept
     : instance_handle(std::exchange(other.instance_handle, VK_NULL_HANDLE)),
     surface_handle(std::exchange(other.surface_handle, VK_NULL_HANDLE)),
-    application_info(other.application_info) {}
+    application_info(other.application_info),
+    physical_device_properties2(other.physical_device_properties2) {}
 
 eng::instance& eng::instance::operator=(instance&& other) noexcept {
     if (this != &other) {
@@ -80,6 +91,7 @@ eng::instance& eng::instance::operator=(instance&& other) noexcept {
         instance_handle = std::exchange(other.instance_handle, VK_NULL_HANDLE);
         surface_handle = std::exchange(other.surface_handle, VK_NULL_HANDLE);
         application_info = other.application_info;
+        physical_device_properties2 = other.physical_device_properties2;
     }
 
     return *this;
@@ -110,3 +122,19 @@ bool eng::instance::check_validation_layer_support() {
 
     return true;
 }
+
+bool eng::instance::check_instance_extension_support(const char* extension_name) {
+    uint32_t extension_count;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, available_extensions.data());
+
+    for (const VkExtensionProperties& extension : available_extensions) {
+        if (strcmp(extension_name, extension.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,336 @@
+#include "../include/light_clusters.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(eng::light_clusters::light) == 32, "light must match the std430 layout in cluster.glsl");
+
+namespace {
+    enum binding_index : uint32_t {
+        light_binding,
+        count_binding,
+        range_binding,
+        index_binding,
+        info_binding
+    };
+
+    // the shading set leaves out the counts, which only matter while binning
+    enum shading_binding_index : uint32_t {
+        shading_light_binding,
+        shading_range_binding,
+        shading_index_binding,
+        shading_info_binding
+    };
+
+    enum bin_mode : uint32_t {
+        bin_count,
+        bin_fill
+    };
+
+    constexpr uint32_t default_lights_per_cluster = 64;
+}
+
+eng::result<eng::light_clusters> eng::light_clusters::create_light_clusters(const eng::device& device, uint32_t max_lights,
+    const glm::uvec3& grid, uint32_t max_light_indices, const char* shader_directory) {
+    if (!device.valid()) {
+        return eng::result<eng::light_clusters>::error("Invalid device.");
+    }
+
+    if (max_lights == 0) {
+        return eng::result<eng::light_clusters>::error("Light capacity must be greater than zero.");
+    }
+
+    if (grid.x == 0 || grid.y == 0 || grid.z == 0) {
+        return eng::result<eng::light_clusters>::error("Cluster grid dimensions must be greater than zero.");
+    }
+
+    uint64_t cluster_count = static_cast<uint64_t>(grid.x) * grid.y * grid.z;
+
+    if (cluster_count > (1u << 24)) {
+        return eng::result<eng::light_clusters>::error("Cluster grid must have at most 2^24 clusters.");
+    }
+
+    if (max_light_indices == 0) {
+        max_light_indices = static_cast<uint32_t>(cluster_count * default_lights_per_cluster);
+    }
+
+    eng::light_clusters clusters;
+    clusters.grid = grid;
+    clusters.max_lights = max_lights;
+    clusters.max_light_indices = max_light_indices;
+
+    struct buffer_description {
+        eng::buffer* buffer;
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+        VkMemoryPropertyFlags properties;
+    };
+
+    buffer_description buffers[] = {
+        { &clusters.light_buffer, static_cast<VkDeviceSize>(max_lights) * sizeof(light),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT },
+        { &clusters.count_buffer, cluster_count * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+        { &clusters.range_buffer, cluster_count * 2 * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+        { &clusters.index_buffer, static_cast<VkDeviceSize>(max_light_indices) * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+        { &clusters.info_buffer, info_size,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT },
+        { &clusters.statistics_readback_buffer, sizeof(statistics),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT }
+    };
+
+    for (buffer_description& description : buffers) {
+        eng::result<eng::buffer> buffer_result = eng::buffer::create_buffer(device, description.size, description.usage, description.properties);
+
+        if (buffer_result.is_error()) {
+            return eng::result<eng::light_clusters>::error(buffer_result.error_message());
+        }
+
+        *description.buffer = std::move(buffer_result.unwrap());
+    }
+
+    statistics empty_statistics{};
+    clusters.statistics_readback_buffer.write(&empty_statistics, sizeof(statistics));
+
+    std::vector<eng::descriptor_layout::binding> cull_bindings;
+
+    for (uint32_t i = light_binding; i <= info_binding; ++i) {
+        cull_bindings.push_back({ i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER });
+    }
+
+    eng::result<eng::descriptor_layout> cull_layout_result = eng::descriptor_layout::create_descriptor_layout(device, cull_bindings);
+
+    if (cull_layout_result.is_error()) {
+        return eng::result<eng::light_clusters>::error(cull_layout_result.error_message());
+    }
+
+    clusters.cull_layout = std::move(cull_layout_result.unwrap());
+
+    std::vector<eng::descriptor_layout::binding> shading_bindings;
+
+    for (uint32_t i = shading_light_binding; i <= shading_info_binding; ++i) {
+        shading_bindings.push_back({ i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT });
+    }
+
+    eng::result<eng::descriptor_layout> shading_layout_result = eng::descriptor_layout::create_descriptor_layout(device, shading_bindings);
+
+    if (shading_layout_result.is_error()) {
+        return eng::result<eng::light_clusters>::error(shading_layout_result.error_message());
+    }
+
+    clusters.shading_layout = std::move(shading_layout_result.unwrap());
+
+    eng::result<VkDescriptorSet> cull_set_result = clusters.cull_layout.allocate_set();
+
+    if (cull_set_result.is_error()) {
+        return eng::result<eng::light_clusters>::error(cull_set_result.error_message());
+    }
+
+    clusters.cull_set = cull_set_result.unwrap();
+
+    eng::result<VkDescriptorSet> shading_set_result = clusters.shading_layout.allocate_set();
+
+    if (shading_set_result.is_error()) {
+        return eng::result<eng::light_clusters>::error(shading_set_result.error_message());
+    }
+
+    clusters.shading_set = shading_set_result.unwrap();
+
+    eng::descriptor_writer writer;
+
+    writer.write_storage_buffer(clusters.cull_set, light_binding, clusters.light_buffer)
+        .write_storage_buffer(clusters.cull_set, count_binding, clusters.count_buffer)
+        .write_storage_buffer(clusters.cull_set, range_binding, clusters.range_buffer)
+        .write_storage_buffer(clusters.cull_set, index_binding, clusters.index_buffer)
+        .write_storage_buffer(clusters.cull_set, info_binding, clusters.info_buffer)
+        .write_storage_buffer(clusters.shading_set, shading_light_binding, clusters.light_buffer)
+        .write_storage_buffer(clusters.shading_set, shading_range_binding, clusters.range_buffer)
+        .write_storage_buffer(clusters.shading_set, shading_index_binding, clusters.index_buffer)
+        .write_storage_buffer(clusters.shading_set, shading_info_binding, clusters.info_buffer)
+        .update(device);
+
+    VkDescriptorSetLayout set_layout = clusters.cull_layout.get_vulkan_descriptor_set_layout();
+    uint32_t push_constant_size = sizeof(push_constants);
+
+    struct pipeline_description {
+        eng::compute_pipeline* pipeline;
+        const char* name;
+        std::vector<uint32_t> specialization_constants;
+    };
+
+    pipeline_description pipelines[] = {
+        { &clusters.count_pipeline, "cluster_bin.comp.spv", { bin_count } },
+        { &clusters.scan_pipeline, "cluster_scan.comp.spv", {} },
+        { &clusters.fill_pipeline, "cluster_bin.comp.spv", { bin_fill } }
+    };
+
+    for (pipeline_description& description : pipelines) {
+        eng::result<eng::compute_pipeline> pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, shader_directory,
+            description.name, { set_layout }, push_constant_size, description.specialization_constants);
+
+        if (pipeline_result.is_error()) {
+            return eng::result<eng::light_clusters>::error(pipeline_result.error_message());
+        }
+
+        *description.pipeline = std::move(pipeline_result.unwrap());
+    }
+
+    return eng::result<eng::light_clusters>::success(std::move(clusters));
+}
+
+eng::light_clusters::light_clusters()
+    : cull_set(VK_NULL_HANDLE),
+    shading_set(VK_NULL_HANDLE),
+    grid(0),
+    max_lights(0),
+    light_count(0),
+    max_light_indices(0) {}
+
+eng::light_clusters::light_clusters(eng::light_clusters&& other) noexcept
+    : cull_layout(std::move(other.cull_layout)),
+    shading_layout(std::move(other.shading_layout)),
+    cull_set(std::exchange(other.cull_set, VK_NULL_HANDLE)),
+    shading_set(std::exchange(other.shading_set, VK_NULL_HANDLE)),
+    count_pipeline(std::move(other.count_pipeline)),
+    scan_pipeline(std::move(other.scan_pipeline)),
+    fill_pipeline(std::move(other.fill_pipeline)),
+    light_buffer(std::move(other.light_buffer)),
+    count_buffer(std::move(other.count_buffer)),
+    range_buffer(std::move(other.range_buffer)),
+    index_buffer(std::move(other.index_buffer)),
+    info_buffer(std::move(other.info_buffer)),
+    statistics_readback_buffer(std::move(other.statistics_readback_buffer)),
+    grid(std::exchange(other.grid, glm::uvec3(0))),
+    max_lights(std::exchange(other.max_lights, 0)),
+    light_count(std::exchange(other.light_count, 0)),
+    max_light_indices(std::exchange(other.max_light_indices, 0)) {}
+
+eng::light_clusters& eng::light_clusters::operator=(eng::light_clusters&& other) noexcept {
+    if (this != &other) {
+        // cull_set and shading_set were allocated from the two layouts, which are only replaced after everything that uses them
+        count_pipeline = std::move(other.count_pipeline);
+        scan_pipeline = std::move(other.scan_pipeline);
+        fill_pipeline = std::move(other.fill_pipeline);
+        light_buffer = std::move(other.light_buffer);
+        count_buffer = std::move(other.count_buffer);
+        range_buffer = std::move(other.range_buffer);
+        index_buffer = std::move(other.index_buffer);
+        info_buffer = std::move(other.info_buffer);
+        statistics_readback_buffer = std::move(other.statistics_readback_buffer);
+        cull_layout = std::move(other.cull_layout);
+        shading_layout = std::move(other.shading_layout);
+        cull_set = std::exchange(other.cull_set, VK_NULL_HANDLE);
+        shading_set = std::exchange(other.shading_set, VK_NULL_HANDLE);
+        grid = std::exchange(other.grid, glm::uvec3(0));
+        max_lights = std::exchange(other.max_lights, 0);
+        light_count = std::exchange(other.light_count, 0);
+        max_light_indices = std::exchange(other.max_light_indices, 0);
+    }
+
+    return *this;
+}
+
+void eng::light_clusters::set_lights(const std::vector<light>& lights) {
+    if (lights.size() > max_lights) {
+        throw std::out_of_range("Light count exceeds the light cluster capacity.");
+    }
+
+    if (!lights.empty()) {
+        light_buffer.write(lights.data(), lights.size() * sizeof(light));
+    }
+
+    light_count = static_cast<uint32_t>(lights.size());
+}
+
+void eng::light_clusters::record_cull(VkCommandBuffer command_buffer, const glm::mat4& view, const glm::mat4& projection,
+    float near_plane, float far_plane, uint32_t width, uint32_t height, bool flipped_viewport) {
+    if (!valid()) {
+        throw std::logic_error("Light clusters are not initialized.");
+    }
+
+    if (near_plane <= 0.0f || far_plane <= near_plane) {
+        throw std::invalid_argument("Light clusters need a positive near plane in front of the far plane.");
+    }
+
+    if (width == 0 || height == 0) {
+        throw std::invalid_argument("Light clusters need a non-empty framebuffer.");
+    }
+
+    // slice = log(depth) * scale + bias, so slice k starts at near * (far / near)^(k / grid.z)
+    float log_ratio = std::log(far_plane / near_plane);
+    float slice_scale = static_cast<float>(grid.z) / log_ratio;
+    float slice_bias = -static_cast<float>(grid.z) * std::log(near_plane) / log_ratio;
+
+    push_constants constants{};
+    constants.view = view;
+    // binning puts row 0 at ndc y = -1, a flipped viewport shows ndc y = +1 at the top, so the rows are mirrored by the y scale
+    float y_scale = flipped_viewport ? -projection[1][1] : projection[1][1];
+
+    constants.projection = glm::vec4(projection[0][0], y_scale, near_plane, far_plane);
+    constants.depth_slicing = glm::vec4(slice_scale, slice_bias, static_cast<float>(width), static_cast<float>(height));
+    constants.grid = glm::uvec4(grid, light_count);
+    constants.max_light_indices = max_light_indices;
+
+    // the previous frame's shading and statistics copy read what this cull rewrites
+    compute_pipeline::record_barrier(command_buffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    compute_pipeline::record_fill_buffer(command_buffer, count_buffer, 0);
+    compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    uint32_t bin_groups = compute_pipeline::group_count(light_count, bin_workgroup_size);
+
+    count_pipeline.bind(command_buffer);
+    count_pipeline.bind_descriptor_set(command_buffer, 0, cull_set);
+    count_pipeline.push_constants(command_buffer, constants);
+
+    if (bin_groups > 0) {
+        count_pipeline.dispatch(command_buffer, bin_groups);
+    }
+
+    compute_pipeline::record_barrier(command_buffer);
+
+    // a single workgroup turns the counts into list offsets and resets them as the fill cursors
+    scan_pipeline.bind(command_buffer);
+    scan_pipeline.dispatch(command_buffer, 1);
+    compute_pipeline::record_barrier(command_buffer);
+
+    if (bin_groups > 0) {
+        fill_pipeline.bind(command_buffer);
+        fill_pipeline.dispatch(command_buffer, bin_groups);
+    }
+
+    compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferCopy copy{};
+    copy.srcOffset = statistics_offset;
+    copy.size = sizeof(statistics);
+
+    compute_pipeline::record_copy_buffer(command_buffer, info_buffer, statistics_readback_buffer, copy);
+}
+
+eng::light_clusters::statistics eng::light_clusters::get_statistics() const {
+    statistics result{};
+
+    if (statistics_readback_buffer.get_mapped_data() != nullptr) {
+        memcpy(&result, statistics_readback_buffer.get_mapped_data(), sizeof(statistics));
+    }
+
+    return result;
+}
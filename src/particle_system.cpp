@@ -0,0 +1,355 @@
+#include "../include/particle_system.hpp"
+#include "../include/capture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(eng::particle_system::particle) == 32, "particle must match the std430 layout in particle.glsl");
+
+namespace {
+    enum binding_index : uint32_t {
+        source_binding,
+        destination_binding,
+        counter_binding,
+        sort_binding,
+        argument_binding
+    };
+
+    // counters in particle.glsl: alive, emit, first emit, next and sort count
+    constexpr VkDeviceSize counter_size = 5 * sizeof(uint32_t);
+    // dispatch arguments for emit, simulate and sort followed by the draw command
+    constexpr VkDeviceSize argument_size = 9 * sizeof(uint32_t) + sizeof(VkDrawIndirectCommand);
+
+    enum sort_mode : uint32_t {
+        sort_local,
+        sort_step,
+        sort_merge
+    };
+
+    uint32_t hash(uint32_t value) {
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+
+        return value;
+    }
+}
+
+eng::result<eng::particle_system> eng::particle_system::create_particle_system(const eng::device& device, uint32_t capacity, const char* shader_directory) {
+    if (!device.valid()) {
+        return eng::result<eng::particle_system>::error("Invalid device.");
+    }
+
+    if (capacity == 0) {
+        return eng::result<eng::particle_system>::error("Particle capacity must be greater than zero.");
+    }
+
+    if (capacity > (1u << 30)) {
+        return eng::result<eng::particle_system>::error("Particle capacity must be at most 2^30.");
+    }
+
+    eng::particle_system system;
+    system.capacity = capacity;
+    system.sort_capacity = sort_block_size;
+
+    while (system.sort_capacity < capacity) {
+        system.sort_capacity <<= 1;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    // the indirect dispatches are one dimensional, so their group counts have to fit the device's x limit
+    uint32_t max_group_count = properties.limits.maxComputeWorkGroupCount[0];
+
+    if (compute_pipeline::group_count(capacity, simulate_group_size) > max_group_count || system.sort_capacity / sort_block_size > max_group_count) {
+        return eng::result<eng::particle_system>::error("Particle capacity exceeds the device's compute workgroup count limit.");
+    }
+
+    for (eng::buffer& particle_buffer : system.particle_buffers) {
+        eng::result<eng::buffer> particle_buffer_result = eng::buffer::create_buffer(device, static_cast<VkDeviceSize>(capacity) * sizeof(particle),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+        if (particle_buffer_result.is_error()) {
+            return eng::result<eng::particle_system>::error(particle_buffer_result.error_message());
+        }
+
+        particle_buffer = std::move(particle_buffer_result.unwrap());
+    }
+
+    eng::result<eng::buffer> counter_buffer_result = eng::buffer::create_buffer(device, counter_size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+    if (counter_buffer_result.is_error()) {
+        return eng::result<eng::particle_system>::error(counter_buffer_result.error_message());
+    }
+
+    system.counter_buffer = std::move(counter_buffer_result.unwrap());
+
+    eng::result<eng::buffer> sort_buffer_result = eng::buffer::create_buffer(device, static_cast<VkDeviceSize>(system.sort_capacity) * 2 * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+    if (sort_buffer_result.is_error()) {
+        return eng::result<eng::particle_system>::error(sort_buffer_result.error_message());
+    }
+
+    system.sort_buffer = std::move(sort_buffer_result.unwrap());
+
+    eng::result<eng::buffer> argument_buffer_result = eng::buffer::create_buffer(device, argument_size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+    if (argument_buffer_result.is_error()) {
+        return eng::result<eng::particle_system>::error(argument_buffer_result.error_message());
+    }
+
+    system.argument_buffer = std::move(argument_buffer_result.unwrap());
+
+    std::vector<eng::descriptor_layout::binding> bindings;
+
+    for (uint32_t i = source_binding; i <= argument_binding; ++i) {
+        bindings.push_back({ i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER });
+    }
+
+    eng::result<eng::descriptor_layout> layout_result = eng::descriptor_layout::create_descriptor_layout(device, bindings, 2);
+
+    if (layout_result.is_error()) {
+        return eng::result<eng::particle_system>::error(layout_result.error_message());
+    }
+
+    system.layout = std::move(layout_result.unwrap());
+
+    // set i reads list i and writes the other one
+    eng::descriptor_writer writer;
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        eng::result<VkDescriptorSet> set_result = system.layout.allocate_set();
+
+        if (set_result.is_error()) {
+            return eng::result<eng::particle_system>::error(set_result.error_message());
+        }
+
+        system.descriptor_sets[i] = set_result.unwrap();
+
+        writer.write_storage_buffer(system.descriptor_sets[i], source_binding, system.particle_buffers[i])
+            .write_storage_buffer(system.descriptor_sets[i], destination_binding, system.particle_buffers[1 - i])
+            .write_storage_buffer(system.descriptor_sets[i], counter_binding, system.counter_buffer)
+            .write_storage_buffer(system.descriptor_sets[i], sort_binding, system.sort_buffer)
+            .write_storage_buffer(system.descriptor_sets[i], argument_binding, system.argument_buffer);
+    }
+
+    writer.update(device);
+
+    VkDescriptorSetLayout set_layout = system.layout.get_vulkan_descriptor_set_layout();
+    uint32_t push_constant_size = sizeof(push_constants);
+
+    struct pipeline_description {
+        eng::compute_pipeline* pipeline;
+        const char* name;
+        std::vector<uint32_t> specialization_constants;
+    };
+
+    pipeline_description pipelines[] = {
+        { &system.begin_arguments_pipeline, "particle_args.comp.spv", { 0 } },
+        { &system.end_arguments_pipeline, "particle_args.comp.spv", { 1 } },
+        { &system.emit_pipeline, "particle_emit.comp.spv", {} },
+        { &system.simulate_pipeline, "particle_simulate.comp.spv", {} },
+        { &system.sort_local_pipeline, "particle_sort.comp.spv", { sort_local } },
+        { &system.sort_step_pipeline, "particle_sort.comp.spv", { sort_step } },
+        { &system.sort_merge_pipeline, "particle_sort.comp.spv", { sort_merge } }
+    };
+
+    for (pipeline_description& description : pipelines) {
+        eng::result<eng::compute_pipeline> pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, shader_directory,
+            description.name, { set_layout }, push_constant_size, description.specialization_constants);
+
+        if (pipeline_result.is_error()) {
+            return eng::result<eng::particle_system>::error(pipeline_result.error_message());
+        }
+
+        *description.pipeline = std::move(pipeline_result.unwrap());
+    }
+
+    return eng::result<eng::particle_system>::success(std::move(system));
+}
+
+eng::particle_system::particle_system()
+    : descriptor_sets{ VK_NULL_HANDLE, VK_NULL_HANDLE },
+    capacity(0),
+    sort_capacity(0),
+    parity(0),
+    frame_index(0),
+    burst_count(0),
+    emit_accumulator(0.0f),
+    sorting(true),
+    counters_cleared(false) {}
+
+eng::particle_system::particle_system(eng::particle_system&& other) noexcept
+    : layout(std::move(other.layout)),
+    descriptor_sets{ std::exchange(other.descriptor_sets[0], VK_NULL_HANDLE), std::exchange(other.descriptor_sets[1], VK_NULL_HANDLE) },
+    begin_arguments_pipeline(std::move(other.begin_arguments_pipeline)),
+    end_arguments_pipeline(std::move(other.end_arguments_pipeline)),
+    emit_pipeline(std::move(other.emit_pipeline)),
+    simulate_pipeline(std::move(other.simulate_pipeline)),
+    sort_local_pipeline(std::move(other.sort_local_pipeline)),
+    sort_step_pipeline(std::move(other.sort_step_pipeline)),
+    sort_merge_pipeline(std::move(other.sort_merge_pipeline)),
+    particle_buffers{ std::move(other.particle_buffers[0]), std::move(other.particle_buffers[1]) },
+    counter_buffer(std::move(other.counter_buffer)),
+    sort_buffer(std::move(other.sort_buffer)),
+    argument_buffer(std::move(other.argument_buffer)),
+    current_emitter(other.current_emitter),
+    capacity(std::exchange(other.capacity, 0)),
+    sort_capacity(std::exchange(other.sort_capacity, 0)),
+    parity(std::exchange(other.parity, 0)),
+    frame_index(std::exchange(other.frame_index, 0)),
+    burst_count(std::exchange(other.burst_count, 0)),
+    emit_accumulator(std::exchange(other.emit_accumulator, 0.0f)),
+    sorting(other.sorting),
+    counters_cleared(std::exchange(other.counters_cleared, false)) {}
+
+eng::particle_system& eng::particle_system::operator=(eng::particle_system&& other) noexcept {
+    if (this != &other) {
+        // pipelines and buffers go before the layout their sets came from
+        begin_arguments_pipeline = std::move(other.begin_arguments_pipeline);
+        end_arguments_pipeline = std::move(other.end_arguments_pipeline);
+        emit_pipeline = std::move(other.emit_pipeline);
+        simulate_pipeline = std::move(other.simulate_pipeline);
+        sort_local_pipeline = std::move(other.sort_local_pipeline);
+        sort_step_pipeline = std::move(other.sort_step_pipeline);
+        sort_merge_pipeline = std::move(other.sort_merge_pipeline);
+        particle_buffers[0] = std::move(other.particle_buffers[0]);
+        particle_buffers[1] = std::move(other.particle_buffers[1]);
+        counter_buffer = std::move(other.counter_buffer);
+        sort_buffer = std::move(other.sort_buffer);
+        argument_buffer = std::move(other.argument_buffer);
+        layout = std::move(other.layout);
+        descriptor_sets[0] = std::exchange(other.descriptor_sets[0], VK_NULL_HANDLE);
+        descriptor_sets[1] = std::exchange(other.descriptor_sets[1], VK_NULL_HANDLE);
+        current_emitter = other.current_emitter;
+        capacity = std::exchange(other.capacity, 0);
+        sort_capacity = std::exchange(other.sort_capacity, 0);
+        parity = std::exchange(other.parity, 0);
+        frame_index = std::exchange(other.frame_index, 0);
+        burst_count = std::exchange(other.burst_count, 0);
+        emit_accumulator = std::exchange(other.emit_accumulator, 0.0f);
+        sorting = other.sorting;
+        counters_cleared = std::exchange(other.counters_cleared, false);
+    }
+
+    return *this;
+}
+
+void eng::particle_system::record_update(VkCommandBuffer command_buffer, float delta_time, const glm::vec3& camera_position, const glm::vec3& camera_forward) {
+    if (!valid()) {
+        throw std::logic_error("Particle system is not initialized.");
+    }
+
+    if (!counters_cleared) {
+        compute_pipeline::record_fill_buffer(command_buffer, counter_buffer, 0);
+        compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        counters_cleared = true;
+    }
+    else {
+        // the previous update on this queue wrote the counters and the list this one reads
+        compute_pipeline::record_barrier(command_buffer);
+    }
+
+    emit_accumulator += std::max(current_emitter.emit_rate, 0.0f) * std::max(delta_time, 0.0f);
+
+    float whole_particles = std::min(std::floor(emit_accumulator), static_cast<float>(capacity));
+    emit_accumulator -= whole_particles;
+
+    uint32_t requested_emit = static_cast<uint32_t>(whole_particles);
+    requested_emit = std::min<uint64_t>(static_cast<uint64_t>(requested_emit) + burst_count, capacity);
+    burst_count = 0;
+
+    push_constants constants{};
+    constants.emitter_position = glm::vec4(current_emitter.position, current_emitter.radius);
+    constants.emitter_velocity = glm::vec4(current_emitter.velocity, current_emitter.spread);
+    constants.gravity = glm::vec4(current_emitter.gravity, current_emitter.drag);
+    constants.camera_position = glm::vec4(camera_position, 1.0f);
+    constants.camera_forward = glm::vec4(camera_forward, 0.0f);
+    constants.delta_time = delta_time;
+    constants.lifetime_min = current_emitter.lifetime_min;
+    constants.lifetime_max = std::max(current_emitter.lifetime_min, current_emitter.lifetime_max);
+    constants.seed = hash(++frame_index);
+    constants.requested_emit = requested_emit;
+    constants.capacity = capacity;
+
+    // every pipeline shares one layout, so the set and push constants stay bound across pipeline switches
+    begin_arguments_pipeline.bind(command_buffer);
+    begin_arguments_pipeline.bind_descriptor_set(command_buffer, 0, descriptor_sets[parity]);
+    begin_arguments_pipeline.push_constants(command_buffer, constants);
+    begin_arguments_pipeline.dispatch(command_buffer, 1);
+    compute_pipeline::record_barrier(command_buffer);
+
+    emit_pipeline.bind(command_buffer);
+    emit_pipeline.dispatch_indirect(command_buffer, argument_buffer, emit_arguments_offset);
+    compute_pipeline::record_barrier(command_buffer);
+
+    simulate_pipeline.bind(command_buffer);
+    simulate_pipeline.dispatch_indirect(command_buffer, argument_buffer, simulate_arguments_offset);
+    compute_pipeline::record_barrier(command_buffer);
+
+    end_arguments_pipeline.bind(command_buffer);
+    end_arguments_pipeline.dispatch(command_buffer, 1);
+    compute_pipeline::record_barrier(command_buffer);
+
+    if (sorting) {
+        // bitonic sort, blocks are sorted in shared memory and merged with global steps until the
+        // distance fits in a block again. steps past the live sort count exit early on the gpu
+        sort_local_pipeline.bind(command_buffer);
+        sort_local_pipeline.dispatch_indirect(command_buffer, argument_buffer, sort_arguments_offset);
+        compute_pipeline::record_barrier(command_buffer);
+
+        const uint32_t step_offset = static_cast<uint32_t>(offsetof(push_constants, sort_k));
+
+        for (uint32_t k = sort_block_size * 2; k <= sort_capacity; k <<= 1) {
+            sort_step_pipeline.bind(command_buffer);
+
+            for (uint32_t j = k >> 1; j >= sort_block_size; j >>= 1) {
+                uint32_t step[2] = { k, j };
+
+                sort_step_pipeline.push_constants(command_buffer, step, sizeof(step), step_offset);
+                sort_step_pipeline.dispatch_indirect(command_buffer, argument_buffer, sort_arguments_offset);
+                compute_pipeline::record_barrier(command_buffer);
+            }
+
+            uint32_t step[2] = { k, sort_block_size >> 1 };
+
+            sort_merge_pipeline.bind(command_buffer);
+            sort_merge_pipeline.push_constants(command_buffer, step, sizeof(step), step_offset);
+            sort_merge_pipeline.dispatch_indirect(command_buffer, argument_buffer, sort_arguments_offset);
+            compute_pipeline::record_barrier(command_buffer);
+        }
+    }
+
+    parity = 1 - parity;
+}
+
+void eng::particle_system::record_draw_barrier(VkCommandBuffer command_buffer) {
+    compute_pipeline::record_barrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void eng::particle_system::record_draw(VkCommandBuffer command_buffer) const {
+    if (!valid()) {
+        throw std::logic_error("Particle system is not initialized.");
+    }
+
+    vkCmdDrawIndirect(command_buffer, argument_buffer.get_vulkan_buffer(), draw_arguments_offset, 1, sizeof(VkDrawIndirectCommand));
+
+    eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::draw_indirect);
+}
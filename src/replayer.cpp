@@ -0,0 +1,849 @@
+#include "../include/replayer.hpp"
+#include "../include/buffer.hpp"
+#include "../include/compute_pipeline.hpp"
+#include "../include/descriptor_layout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    using record_type = eng::capture::record_type;
+
+    constexpr size_t header_size = sizeof(eng::capture::magic) + sizeof(uint32_t) + eng::capture::device_name_size;
+    constexpr size_t record_header_size = sizeof(uint8_t) + sizeof(uint32_t);
+
+    // bounds checked reads from a record payload, reading past the end leaves the reader failed
+    class payload_reader {
+    public:
+        payload_reader(const uint8_t* data, size_t size) : data(data), size(size), offset(0), failed(false) {}
+
+        template <typename T>
+        T read() {
+            T value{};
+
+            if (const uint8_t* bytes = read_bytes(sizeof(T))) {
+                std::memcpy(&value, bytes, sizeof(T));
+            }
+
+            return value;
+        }
+
+        const uint8_t* read_bytes(size_t count) {
+            if (failed || count > size - offset) {
+                failed = true;
+                return nullptr;
+            }
+
+            const uint8_t* bytes = data + offset;
+            offset += count;
+
+            return bytes;
+        }
+
+        // element counts are checked against the remaining payload before anything is sized by them
+        uint32_t read_count(size_t element_size) {
+            uint32_t count = read<uint32_t>();
+
+            if (failed || count > (size - offset) / element_size) {
+                failed = true;
+                return 0;
+            }
+
+            return count;
+        }
+
+        bool ok() const { return !failed; }
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t offset;
+        bool failed;
+    };
+
+    struct record {
+        record_type type;
+        const uint8_t* payload;
+        uint32_t size;
+    };
+
+    bool is_command(record_type type) {
+        return type >= record_type::bind_pipeline && type <= record_type::update_buffer;
+    }
+
+    bool is_destroy(record_type type) {
+        return type == record_type::destroy_buffer || type == record_type::destroy_pipeline || type == record_type::destroy_descriptor_layout;
+    }
+
+    // objects live for one run, destroyed ones are released once the frame that last used them has finished
+    struct replay_objects {
+        std::unordered_map<uint32_t, eng::buffer> buffers;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> shaders;
+        std::unordered_map<uint32_t, eng::compute_pipeline> pipelines;
+        std::unordered_map<uint32_t, uint32_t> pipeline_set_counts;
+        std::unordered_map<uint32_t, eng::descriptor_layout> layouts;
+        std::unordered_map<uint32_t, VkDescriptorSet> sets;
+
+        std::vector<eng::buffer> retired_buffers;
+        std::vector<eng::compute_pipeline> retired_pipelines;
+        std::vector<eng::descriptor_layout> retired_layouts;
+
+        void release_retired() {
+            retired_buffers.clear();
+            retired_pipelines.clear();
+            retired_layouts.clear();
+        }
+    };
+
+    // what one captured command buffer has bound so far, a dispatch is only recorded when every bind it relies on was
+    struct binding_state {
+        const eng::compute_pipeline* pipeline = nullptr;
+        uint32_t set_count = 0;
+        // bit per set index whose latest bind was recorded
+        uint32_t bound_sets = 0;
+
+        bool dispatchable() const {
+            uint32_t required = set_count >= 32 ? ~0u : (1u << set_count) - 1;
+
+            return pipeline != nullptr && (bound_sets & required) == required;
+        }
+    };
+
+    template <typename T>
+    T* find_object(std::unordered_map<uint32_t, T>& objects, uint32_t id) {
+        auto found = objects.find(id);
+
+        return found != objects.end() ? &found->second : nullptr;
+    }
+
+    template <typename T>
+    void retire_object(std::unordered_map<uint32_t, T>& objects, std::vector<T>& retired, uint32_t id) {
+        auto found = objects.find(id);
+
+        if (found != objects.end()) {
+            retired.push_back(std::move(found->second));
+            objects.erase(found);
+        }
+    }
+
+    // creates or destroys the object a resource record describes, false when the record is malformed or creation fails.
+    // objects that depend on ones the capture has no record of are left out
+    bool apply_resource(const eng::device& device, replay_objects& objects, const record& current) {
+        payload_reader reader(current.payload, current.size);
+
+        switch (current.type) {
+        case record_type::create_buffer: {
+            uint32_t id = reader.read<uint32_t>();
+            uint64_t size = reader.read<uint64_t>();
+            uint32_t usage = reader.read<uint32_t>();
+            uint32_t properties = reader.read<uint32_t>();
+            bool concurrent = reader.read<uint8_t>() != 0;
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            eng::result<eng::buffer> buffer_result = eng::buffer::create_buffer(device, size, usage, properties, concurrent);
+
+            if (buffer_result.is_error()) {
+                return false;
+            }
+
+            objects.buffers[id] = std::move(buffer_result.unwrap());
+            return true;
+        }
+        case record_type::destroy_buffer:
+            retire_object(objects.buffers, objects.retired_buffers, reader.read<uint32_t>());
+            return reader.ok();
+        case record_type::write_buffer: {
+            uint32_t id = reader.read<uint32_t>();
+            uint64_t offset = reader.read<uint64_t>();
+            uint64_t size = reader.read<uint64_t>();
+            const uint8_t* bytes = reader.read_bytes(static_cast<size_t>(size));
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            eng::buffer* buffer = find_object(objects.buffers, id);
+
+            if (buffer != nullptr && buffer->get_mapped_data() != nullptr && offset + size <= buffer->get_size()) {
+                buffer->write(bytes, size, offset);
+            }
+
+            return true;
+        }
+        case record_type::create_shader: {
+            uint32_t id = reader.read<uint32_t>();
+            uint32_t word_count = reader.read<uint32_t>();
+            const uint8_t* words = reader.read_bytes(static_cast<size_t>(word_count) * sizeof(uint32_t));
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            std::vector<uint32_t>& code = objects.shaders[id];
+            code.resize(word_count);
+            std::memcpy(code.data(), words, code.size() * sizeof(uint32_t));
+
+            return true;
+        }
+        case record_type::create_compute_pipeline: {
+            uint32_t id = reader.read<uint32_t>();
+            uint32_t shader_id = reader.read<uint32_t>();
+            uint32_t push_constant_size = reader.read<uint32_t>();
+
+            std::vector<VkDescriptorSetLayout> set_layouts(reader.read_count(sizeof(uint32_t)));
+
+            for (VkDescriptorSetLayout& set_layout : set_layouts) {
+                eng::descriptor_layout* layout = find_object(objects.layouts, reader.read<uint32_t>());
+                set_layout = layout != nullptr ? layout->get_vulkan_descriptor_set_layout() : VK_NULL_HANDLE;
+            }
+
+            std::vector<uint32_t> specialization_constants(reader.read_count(sizeof(uint32_t)));
+
+            for (uint32_t& constant : specialization_constants) {
+                constant = reader.read<uint32_t>();
+            }
+
+            std::vector<uint32_t>* code = find_object(objects.shaders, shader_id);
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            // a layout created before the capture started, commands using the pipeline are skipped
+            if (code == nullptr || std::count(set_layouts.begin(), set_layouts.end(), VK_NULL_HANDLE) != 0) {
+                return true;
+            }
+
+            eng::result<eng::compute_pipeline> pipeline_result = eng::compute_pipeline::create_compute_pipeline(device, *code,
+                set_layouts, push_constant_size, specialization_constants);
+
+            if (pipeline_result.is_error()) {
+                return false;
+            }
+
+            objects.pipelines[id] = std::move(pipeline_result.unwrap());
+            objects.pipeline_set_counts[id] = static_cast<uint32_t>(set_layouts.size());
+            return true;
+        }
+        case record_type::destroy_pipeline:
+            retire_object(objects.pipelines, objects.retired_pipelines, reader.read<uint32_t>());
+            return reader.ok();
+        case record_type::create_descriptor_layout: {
+            uint32_t id = reader.read<uint32_t>();
+            uint32_t max_sets = reader.read<uint32_t>();
+
+            std::vector<eng::descriptor_layout::binding> bindings(reader.read_count(4 * sizeof(uint32_t)));
+
+            for (eng::descriptor_layout::binding& binding : bindings) {
+                binding.binding = reader.read<uint32_t>();
+                binding.type = static_cast<VkDescriptorType>(reader.read<uint32_t>());
+                binding.stages = reader.read<uint32_t>();
+                binding.count = reader.read<uint32_t>();
+            }
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            eng::result<eng::descriptor_layout> layout_result = eng::descriptor_layout::create_descriptor_layout(device, bindings, max_sets);
+
+            if (layout_result.is_error()) {
+                return false;
+            }
+
+            objects.layouts[id] = std::move(layout_result.unwrap());
+            return true;
+        }
+        case record_type::destroy_descriptor_layout:
+            retire_object(objects.layouts, objects.retired_layouts, reader.read<uint32_t>());
+            return reader.ok();
+        case record_type::allocate_descriptor_set: {
+            uint32_t id = reader.read<uint32_t>();
+            eng::descriptor_layout* layout = find_object(objects.layouts, reader.read<uint32_t>());
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            if (layout == nullptr) {
+                return true;
+            }
+
+            eng::result<VkDescriptorSet> set_result = layout->allocate_set();
+
+            if (set_result.is_error()) {
+                return false;
+            }
+
+            objects.sets[id] = set_result.unwrap();
+            return true;
+        }
+        case record_type::write_descriptor_buffer: {
+            VkDescriptorSet* set = find_object(objects.sets, reader.read<uint32_t>());
+            uint32_t binding = reader.read<uint32_t>();
+            VkDescriptorType type = static_cast<VkDescriptorType>(reader.read<uint32_t>());
+            eng::buffer* buffer = find_object(objects.buffers, reader.read<uint32_t>());
+            uint64_t offset = reader.read<uint64_t>();
+            uint64_t range = reader.read<uint64_t>();
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            if (set != nullptr && buffer != nullptr) {
+                eng::descriptor_writer writer;
+                writer.write_buffer(*set, binding, type, buffer->get_vulkan_buffer(), offset, range);
+                writer.update(device);
+            }
+
+            return true;
+        }
+        case record_type::write_descriptor_image: {
+            uint32_t id = reader.read<uint32_t>();
+            reader.read<uint32_t>();
+            reader.read<uint32_t>();
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            // the image isn't in the capture, binding the set would read an unwritten descriptor
+            objects.sets.erase(id);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // records one captured command, false when it references an object that doesn't exist or relies on a bind that was skipped
+    bool apply_command(VkCommandBuffer command_buffer, replay_objects& objects, binding_state& bindings, const record& current) {
+        payload_reader reader(current.payload, current.size);
+        reader.read<uint32_t>();
+
+        switch (current.type) {
+        case record_type::bind_pipeline: {
+            uint32_t id = reader.read<uint32_t>();
+            eng::compute_pipeline* pipeline = find_object(objects.pipelines, id);
+
+            bindings.pipeline = reader.ok() ? pipeline : nullptr;
+
+            if (bindings.pipeline == nullptr) {
+                return false;
+            }
+
+            bindings.set_count = objects.pipeline_set_counts[id];
+            pipeline->bind(command_buffer);
+            return true;
+        }
+        case record_type::bind_descriptor_set: {
+            eng::compute_pipeline* pipeline = find_object(objects.pipelines, reader.read<uint32_t>());
+            uint32_t index = reader.read<uint32_t>();
+            VkDescriptorSet* set = find_object(objects.sets, reader.read<uint32_t>());
+
+            uint32_t bit = index < 32 ? 1u << index : 0;
+
+            if (!reader.ok() || pipeline == nullptr || set == nullptr) {
+                bindings.bound_sets &= ~bit;
+                return false;
+            }
+
+            pipeline->bind_descriptor_set(command_buffer, index, *set);
+            bindings.bound_sets |= bit;
+            return true;
+        }
+        case record_type::push_constants: {
+            eng::compute_pipeline* pipeline = find_object(objects.pipelines, reader.read<uint32_t>());
+            uint32_t offset = reader.read<uint32_t>();
+            uint32_t size = reader.read<uint32_t>();
+            const uint8_t* bytes = reader.read_bytes(size);
+
+            if (!reader.ok() || pipeline == nullptr || bindings.pipeline == nullptr || offset + size > pipeline->get_push_constant_size()) {
+                return false;
+            }
+
+            pipeline->push_constants(command_buffer, bytes, size, offset);
+            return true;
+        }
+        case record_type::dispatch: {
+            uint32_t x = reader.read<uint32_t>();
+            uint32_t y = reader.read<uint32_t>();
+            uint32_t z = reader.read<uint32_t>();
+
+            if (!reader.ok() || !bindings.dispatchable()) {
+                return false;
+            }
+
+            vkCmdDispatch(command_buffer, x, y, z);
+            return true;
+        }
+        case record_type::dispatch_indirect: {
+            eng::buffer* buffer = find_object(objects.buffers, reader.read<uint32_t>());
+            uint64_t offset = reader.read<uint64_t>();
+
+            if (!reader.ok() || buffer == nullptr || !bindings.dispatchable()) {
+                return false;
+            }
+
+            vkCmdDispatchIndirect(command_buffer, buffer->get_vulkan_buffer(), offset);
+            return true;
+        }
+        case record_type::pipeline_barrier: {
+            uint32_t source_stages = reader.read<uint32_t>();
+            uint32_t destination_stages = reader.read<uint32_t>();
+            uint32_t source_access = reader.read<uint32_t>();
+            uint32_t destination_access = reader.read<uint32_t>();
+
+            if (!reader.ok()) {
+                return false;
+            }
+
+            eng::compute_pipeline::record_barrier(command_buffer, source_stages, destination_stages, source_access, destination_access);
+            return true;
+        }
+        case record_type::fill_buffer: {
+            eng::buffer* buffer = find_object(objects.buffers, reader.read<uint32_t>());
+            uint64_t offset = reader.read<uint64_t>();
+            uint64_t size = reader.read<uint64_t>();
+            uint32_t value = reader.read<uint32_t>();
+
+            if (!reader.ok() || buffer == nullptr) {
+                return false;
+            }
+
+            vkCmdFillBuffer(command_buffer, buffer->get_vulkan_buffer(), offset, size, value);
+            return true;
+        }
+        case record_type::copy_buffer: {
+            eng::buffer* source = find_object(objects.buffers, reader.read<uint32_t>());
+            eng::buffer* destination = find_object(objects.buffers, reader.read<uint32_t>());
+
+            VkBufferCopy region{};
+            region.srcOffset = reader.read<uint64_t>();
+            region.dstOffset = reader.read<uint64_t>();
+            region.size = reader.read<uint64_t>();
+
+            if (!reader.ok() || source == nullptr || destination == nullptr) {
+                return false;
+            }
+
+            eng::compute_pipeline::record_copy_buffer(command_buffer, *source, *destination, region);
+            return true;
+        }
+        case record_type::update_buffer: {
+            eng::buffer* buffer = find_object(objects.buffers, reader.read<uint32_t>());
+            uint64_t offset = reader.read<uint64_t>();
+            uint64_t size = reader.read<uint64_t>();
+            const uint8_t* bytes = reader.read_bytes(static_cast<size_t>(size));
+
+            if (!reader.ok() || buffer == nullptr || size == 0 || size % 4 != 0 || size > 65536 || offset % 4 != 0 || offset + size > buffer->get_size()) {
+                return false;
+            }
+
+            eng::compute_pipeline::record_update_buffer(command_buffer, *buffer, bytes, size, offset);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+}
+
+eng::result<eng::replayer> eng::replayer::create_replayer(const eng::device& device, const char* path) {
+    if (!device.valid()) {
+        return eng::result<eng::replayer>::error("Invalid device.");
+    }
+
+    if (path == nullptr) {
+        return eng::result<eng::replayer>::error("Invalid capture path.");
+    }
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        return eng::result<eng::replayer>::error("Failed to open capture file.");
+    }
+
+    eng::replayer replayer;
+    replayer.data.resize(static_cast<size_t>(file.tellg()));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(replayer.data.data()), replayer.data.size());
+
+    uint32_t version = 0;
+
+    if (replayer.data.size() >= header_size) {
+        std::memcpy(&version, replayer.data.data() + sizeof(eng::capture::magic), sizeof(version));
+    }
+
+    if (replayer.data.size() < header_size || std::memcmp(replayer.data.data(), eng::capture::magic, sizeof(eng::capture::magic)) != 0) {
+        return eng::result<eng::replayer>::error("File is not a capture.");
+    }
+
+    if (version != eng::capture::format_version) {
+        return eng::result<eng::replayer>::error("Unsupported capture format version.");
+    }
+
+    const char* name = reinterpret_cast<const char*>(replayer.data.data() + sizeof(eng::capture::magic) + sizeof(uint32_t));
+    replayer.captured_device_name.assign(name, std::find(name, name + eng::capture::device_name_size, '\0'));
+    replayer.records_offset = header_size;
+
+    // validate record bounds once so run only has to check payloads
+    size_t offset = header_size;
+
+    while (offset < replayer.data.size()) {
+        if (replayer.data.size() - offset < record_header_size) {
+            return eng::result<eng::replayer>::error("Capture file is truncated.");
+        }
+
+        uint8_t type = replayer.data[offset];
+        uint32_t size;
+        std::memcpy(&size, replayer.data.data() + offset + sizeof(uint8_t), sizeof(size));
+
+        if (type > static_cast<uint8_t>(record_type::end_frame) || size > replayer.data.size() - offset - record_header_size) {
+            return eng::result<eng::replayer>::error("Capture file is truncated or corrupt.");
+        }
+
+        if (type == static_cast<uint8_t>(record_type::end_frame)) {
+            ++replayer.frame_count;
+        }
+
+        offset += record_header_size + size;
+    }
+
+    replayer.logical_device_handle = device.get_vulkan_logical_device();
+
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device.get_vulkan_physical_device(), &family_count, families.data());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    uint32_t valid_bits = families[device.get_graphics_queue_family()].timestampValidBits;
+
+    replayer.timestamp_valid = valid_bits != 0;
+    replayer.timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    replayer.timestamp_period = properties.limits.timestampPeriod;
+
+    VkCommandPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_create_info.queueFamilyIndex = device.get_graphics_queue_family();
+
+    if (vkCreateCommandPool(replayer.logical_device_handle, &pool_create_info, nullptr, &replayer.command_pool_handle) != VK_SUCCESS) {
+        return eng::result<eng::replayer>::error("Failed to create replay command pool.");
+    }
+
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = replayer.command_pool_handle;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(replayer.logical_device_handle, &allocate_info, &replayer.command_buffer_handle) != VK_SUCCESS) {
+        return eng::result<eng::replayer>::error("Failed to allocate replay command buffer.");
+    }
+
+    VkFenceCreateInfo fence_create_info{};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(replayer.logical_device_handle, &fence_create_info, nullptr, &replayer.fence_handle) != VK_SUCCESS) {
+        return eng::result<eng::replayer>::error("Failed to create replay fence.");
+    }
+
+    if (replayer.timestamp_valid) {
+        VkQueryPoolCreateInfo query_create_info{};
+        query_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_create_info.queryCount = 2;
+
+        if (vkCreateQueryPool(replayer.logical_device_handle, &query_create_info, nullptr, &replayer.query_pool_handle) != VK_SUCCESS) {
+            return eng::result<eng::replayer>::error("Failed to create replay query pool.");
+        }
+    }
+
+    return eng::result<eng::replayer>::success(std::move(replayer));
+}
+
+eng::replayer::replayer()
+    : logical_device_handle(VK_NULL_HANDLE),
+    command_pool_handle(VK_NULL_HANDLE),
+    command_buffer_handle(VK_NULL_HANDLE),
+    fence_handle(VK_NULL_HANDLE),
+    query_pool_handle(VK_NULL_HANDLE),
+    records_offset(0),
+    frame_count(0),
+    timestamp_valid(false),
+    timestamp_mask(~0ull),
+    timestamp_period(1.0f),
+    skipped_commands(0),
+    unreplayable_commands{} {}
+
+eng::replayer::~replayer() {
+    destroy();
+}
+
+eng::replayer::replayer(eng::replayer&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    command_pool_handle(std::exchange(other.command_pool_handle, VK_NULL_HANDLE)),
+    command_buffer_handle(std::exchange(other.command_buffer_handle, VK_NULL_HANDLE)),
+    fence_handle(std::exchange(other.fence_handle, VK_NULL_HANDLE)),
+    query_pool_handle(std::exchange(other.query_pool_handle, VK_NULL_HANDLE)),
+    data(std::move(other.data)),
+    records_offset(std::exchange(other.records_offset, 0)),
+    captured_device_name(std::move(other.captured_device_name)),
+    frame_count(std::exchange(other.frame_count, 0)),
+    timestamp_valid(std::exchange(other.timestamp_valid, false)),
+    timestamp_mask(other.timestamp_mask),
+    timestamp_period(other.timestamp_period),
+    skipped_commands(std::exchange(other.skipped_commands, 0)),
+    unreplayable_commands(std::exchange(other.unreplayable_commands, {})) {}
+
+eng::replayer& eng::replayer::operator=(eng::replayer&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        command_pool_handle = std::exchange(other.command_pool_handle, VK_NULL_HANDLE);
+        command_buffer_handle = std::exchange(other.command_buffer_handle, VK_NULL_HANDLE);
+        fence_handle = std::exchange(other.fence_handle, VK_NULL_HANDLE);
+        query_pool_handle = std::exchange(other.query_pool_handle, VK_NULL_HANDLE);
+        data = std::move(other.data);
+        records_offset = std::exchange(other.records_offset, 0);
+        captured_device_name = std::move(other.captured_device_name);
+        frame_count = std::exchange(other.frame_count, 0);
+        timestamp_valid = std::exchange(other.timestamp_valid, false);
+        timestamp_mask = other.timestamp_mask;
+        timestamp_period = other.timestamp_period;
+        skipped_commands = std::exchange(other.skipped_commands, 0);
+        unreplayable_commands = std::exchange(other.unreplayable_commands, {});
+    }
+
+    return *this;
+}
+
+eng::result<std::vector<eng::replayer::frame_timing>> eng::replayer::run(const eng::device& device, eng::replayer::pacing mode) {
+    if (!valid()) {
+        throw std::logic_error("Called run on an invalid replayer.");
+    }
+
+    replay_objects objects;
+    std::vector<frame_timing> timings;
+    timings.reserve(frame_count);
+
+    // commands of one frame grouped by the command buffer they were captured from, in order of first use
+    std::vector<std::pair<uint32_t, record>> frame_commands;
+    std::unordered_map<uint32_t, uint32_t> command_buffer_order;
+    // destroys are applied once the frame has finished, commands captured before them may still use the object
+    std::vector<record> frame_destroys;
+    // only added to the totals once the frame is replayed
+    std::array<uint64_t, eng::capture::unreplayable_kind_count> frame_unreplayable{};
+
+    auto replay_start = std::chrono::steady_clock::now();
+    auto frame_start = replay_start;
+    uint64_t first_timestamp = 0;
+    uint64_t previous_timestamp = 0;
+    bool failed = false;
+
+    skipped_commands = 0;
+    unreplayable_commands = {};
+
+    size_t offset = records_offset;
+
+    while (offset < data.size() && !failed) {
+        record current;
+        current.type = static_cast<record_type>(data[offset]);
+        std::memcpy(&current.size, data.data() + offset + sizeof(uint8_t), sizeof(current.size));
+        current.payload = data.data() + offset + record_header_size;
+
+        offset += record_header_size + current.size;
+
+        if (is_command(current.type)) {
+            payload_reader reader(current.payload, current.size);
+            uint32_t command_buffer = reader.read<uint32_t>();
+
+            if (!reader.ok()) {
+                failed = true;
+                break;
+            }
+
+            uint32_t order = command_buffer_order.emplace(command_buffer, static_cast<uint32_t>(command_buffer_order.size())).first->second;
+            frame_commands.emplace_back(order, current);
+            continue;
+        }
+
+        if (is_destroy(current.type)) {
+            frame_destroys.push_back(current);
+            continue;
+        }
+
+        if (current.type == record_type::unreplayable_command) {
+            payload_reader reader(current.payload, current.size);
+            reader.read<uint32_t>();
+            uint32_t kind = reader.read<uint32_t>();
+            uint32_t count = reader.read<uint32_t>();
+
+            if (!reader.ok() || kind >= eng::capture::unreplayable_kind_count) {
+                failed = true;
+                break;
+            }
+
+            frame_unreplayable[kind] += count;
+            continue;
+        }
+
+        if (current.type != record_type::end_frame) {
+            failed = !apply_resource(device, objects, current);
+            continue;
+        }
+
+        payload_reader reader(current.payload, current.size);
+        uint64_t timestamp = reader.read<uint64_t>();
+
+        if (!reader.ok()) {
+            failed = true;
+            break;
+        }
+
+        std::stable_sort(frame_commands.begin(), frame_commands.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkResetCommandBuffer(command_buffer_handle, 0);
+        vkBeginCommandBuffer(command_buffer_handle, &begin_info);
+
+        if (timestamp_valid) {
+            vkCmdResetQueryPool(command_buffer_handle, query_pool_handle, 0, 2);
+            vkCmdWriteTimestamp(command_buffer_handle, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_handle, 0);
+        }
+
+        binding_state bindings;
+        uint32_t bindings_order = 0;
+
+        for (const auto& [order, command] : frame_commands) {
+            // each captured command buffer starts without anything bound
+            if (order != bindings_order) {
+                bindings = binding_state();
+                bindings_order = order;
+            }
+
+            if (!apply_command(command_buffer_handle, objects, bindings, command)) {
+                ++skipped_commands;
+            }
+        }
+
+        if (timestamp_valid) {
+            vkCmdWriteTimestamp(command_buffer_handle, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_handle, 1);
+        }
+
+        vkEndCommandBuffer(command_buffer_handle);
+
+        if (timings.empty()) {
+            first_timestamp = timestamp;
+            previous_timestamp = timestamp;
+        }
+
+        auto sleep_start = std::chrono::steady_clock::now();
+
+        if (mode == pacing::recorded) {
+            std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(timestamp - first_timestamp));
+        }
+
+        auto sleep_end = std::chrono::steady_clock::now();
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer_handle;
+
+        vkResetFences(logical_device_handle, 1, &fence_handle);
+
+        if (vkQueueSubmit(device.get_vulkan_graphics_queue(), 1, &submit_info, fence_handle) != VK_SUCCESS) {
+            failed = true;
+            break;
+        }
+
+        auto submit_end = std::chrono::steady_clock::now();
+
+        vkWaitForFences(logical_device_handle, 1, &fence_handle, VK_TRUE, UINT64_MAX);
+
+        frame_timing timing{};
+        // pacing sleeps aren't part of the frame's cpu cost
+        timing.cpu_milliseconds = std::chrono::duration<double, std::milli>((submit_end - frame_start) - (sleep_end - sleep_start)).count();
+        timing.recorded_milliseconds = static_cast<double>(timestamp - previous_timestamp) / 1e6;
+        timing.commands = static_cast<uint32_t>(frame_commands.size());
+
+        if (timestamp_valid) {
+            uint64_t timestamps[2];
+            vkGetQueryPoolResults(logical_device_handle, query_pool_handle, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+            timing.gpu_milliseconds = static_cast<double>((timestamps[1] - timestamps[0]) & timestamp_mask) * timestamp_period / 1e6;
+        }
+
+        timings.push_back(timing);
+
+        for (uint32_t kind = 0; kind < eng::capture::unreplayable_kind_count; ++kind) {
+            unreplayable_commands[kind] += frame_unreplayable[kind];
+        }
+
+        frame_unreplayable = {};
+
+        for (const record& destroyed : frame_destroys) {
+            failed = failed || !apply_resource(device, objects, destroyed);
+        }
+
+        objects.release_retired();
+        frame_destroys.clear();
+        frame_commands.clear();
+        command_buffer_order.clear();
+        previous_timestamp = timestamp;
+        frame_start = std::chrono::steady_clock::now();
+    }
+
+    vkDeviceWaitIdle(logical_device_handle);
+
+    if (failed) {
+        return eng::result<std::vector<frame_timing>>::error("Capture is corrupt or an object could not be recreated.");
+    }
+
+    return eng::result<std::vector<frame_timing>>::success(std::move(timings));
+}
+
+void eng::replayer::destroy() {
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (query_pool_handle != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(logical_device_handle, query_pool_handle, nullptr);
+    }
+
+    if (fence_handle != VK_NULL_HANDLE) {
+        vkDestroyFence(logical_device_handle, fence_handle, nullptr);
+    }
+
+    if (command_pool_handle != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(logical_device_handle, command_pool_handle, nullptr);
+    }
+
+    query_pool_handle = VK_NULL_HANDLE;
+    fence_handle = VK_NULL_HANDLE;
+    command_buffer_handle = VK_NULL_HANDLE;
+    command_pool_handle = VK_NULL_HANDLE;
+    logical_device_handle = VK_NULL_HANDLE;
+}
@@ -0,0 +1,89 @@
+#include "../include/shader_module.hpp"
+
+#include <fstream>
+#include <utility>
+
+eng::result<eng::shader_module> eng::shader_module::create_shader_module(const eng::device& device, const std::vector<uint32_t>& code) {
+    if (!device.valid()) {
+        return eng::result<eng::shader_module>::error("Invalid device.");
+    }
+
+    if (code.empty()) {
+        return eng::result<eng::shader_module>::error("Shader code is empty.");
+    }
+
+    VkShaderModuleCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    create_info.codeSize = code.size() * sizeof(uint32_t);
+    create_info.pCode = code.data();
+
+    VkShaderModule shader_module_handle;
+    if (vkCreateShaderModule(device.get_vulkan_logical_device(), &create_info, nullptr, &shader_module_handle) != VK_SUCCESS) {
+        return eng::result<eng::shader_module>::error("Failed to create shader module.");
+    }
+
+    return eng::result<eng::shader_module>::success(shader_module(device.get_vulkan_logical_device(), shader_module_handle));
+}
+
+eng::result<eng::shader_module> eng::shader_module::create_shader_module(const eng::device& device, const char* path) {
+    eng::result<std::vector<uint32_t>> code_result = read_shader_file(path);
+
+    if (code_result.is_error()) {
+        return eng::result<eng::shader_module>::error(code_result.error_message());
+    }
+
+    return create_shader_module(device, code_result.unwrap());
+}
+
+eng::result<std::vector<uint32_t>> eng::shader_module::read_shader_file(const char* path) {
+    if (path == nullptr) {
+        return eng::result<std::vector<uint32_t>>::error("Invalid shader path.");
+    }
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        return eng::result<std::vector<uint32_t>>::error("Failed to open shader file.");
+    }
+
+    size_t file_size = static_cast<size_t>(file.tellg());
+
+    if (file_size == 0 || file_size % sizeof(uint32_t) != 0) {
+        return eng::result<std::vector<uint32_t>>::error("Shader file is not valid SPIR-V.");
+    }
+
+    std::vector<uint32_t> code(file_size / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), file_size);
+
+    return eng::result<std::vector<uint32_t>>::success(std::move(code));
+}
+
+eng::shader_module::shader_module() : logical_device_handle(VK_NULL_HANDLE), shader_module_handle(VK_NULL_HANDLE) {}
+
+eng::shader_module::shader_module(VkDevice logical_device_handle, VkShaderModule shader_module_handle)
+    : logical_device_handle(logical_device_handle), shader_module_handle(shader_module_handle) {}
+
+eng::shader_module::~shader_module() {
+    if (shader_module_handle != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(logical_device_handle, shader_module_handle, nullptr);
+    }
+}
+
+eng::shader_module::shader_module(eng::shader_module&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    shader_module_handle(std::exchange(other.shader_module_handle, VK_NULL_HANDLE)) {}
+
+eng::shader_module& eng::shader_module::operator=(eng::shader_module&& other) noexcept {
+    if (this != &other) {
+        if (shader_module_handle != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(logical_device_handle, shader_module_handle, nullptr);
+        }
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        shader_module_handle = std::exchange(other.shader_module_handle, VK_NULL_HANDLE);
+    }
+
+    return *this;
+}
@@ -0,0 +1,905 @@
+#include "../include/texture_streamer.hpp"
+#include "../include/capture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VkImageMemoryBarrier image_barrier(VkImage image, uint32_t level_count, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags source_access, VkAccessFlags destination_access) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = source_access;
+        barrier.dstAccessMask = destination_access;
+        barrier.oldLayout = old_layout;
+        barrier.newLayout = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = level_count;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        return barrier;
+    }
+
+    constexpr VkPipelineStageFlags sampling_stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+}
+
+eng::result<eng::texture_streamer> eng::texture_streamer::create_texture_streamer(const eng::device& device) {
+    return create_texture_streamer(device, settings());
+}
+
+eng::result<eng::texture_streamer> eng::texture_streamer::create_texture_streamer(const eng::device& device, const eng::texture_streamer::settings& settings) {
+    if (!device.valid()) {
+        return eng::result<eng::texture_streamer>::error("Invalid device.");
+    }
+
+    if (settings.worker_count == 0 || settings.frames_in_flight == 0) {
+        return eng::result<eng::texture_streamer>::error("Worker count and frames in flight must be greater than zero.");
+    }
+
+    if (settings.staging_size < settings.frames_in_flight) {
+        return eng::result<eng::texture_streamer>::error("Staging size must be at least one byte per frame in flight.");
+    }
+
+    if (!(settings.budget_fraction > 0.0f && settings.budget_fraction <= 1.0f)) {
+        return eng::result<eng::texture_streamer>::error("Budget fraction must be in (0, 1].");
+    }
+
+    eng::texture_streamer streamer;
+    streamer.logical_device_handle = device.get_vulkan_logical_device();
+    streamer.configuration = settings;
+
+    vkGetPhysicalDeviceMemoryProperties(device.get_vulkan_physical_device(), &streamer.memory_properties);
+
+    eng::result<uint32_t> memory_type_result = device.find_memory_type(UINT32_MAX, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memory_type_result.is_error()) {
+        return eng::result<eng::texture_streamer>::error(memory_type_result.error_message());
+    }
+
+    streamer.streaming_heap = streamer.memory_properties.memoryTypes[memory_type_result.unwrap()].heapIndex;
+
+    eng::result<eng::buffer> staging_buffer_result = eng::buffer::create_buffer(device, settings.staging_size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (staging_buffer_result.is_error()) {
+        return eng::result<eng::texture_streamer>::error(staging_buffer_result.error_message());
+    }
+
+    streamer.staging_buffer = std::move(staging_buffer_result.unwrap());
+    streamer.staging_region_size = settings.staging_size / settings.frames_in_flight;
+    streamer.retired_images.resize(settings.frames_in_flight);
+    streamer.heap_resident.assign(streamer.memory_properties.memoryHeapCount, 0);
+    streamer.heap_budgets = device.query_memory_budget();
+
+    streamer.shared = std::make_unique<shared_state>();
+
+    for (uint32_t i = 0; i < settings.worker_count; ++i) {
+        streamer.shared->workers.emplace_back(worker_main, streamer.shared.get());
+    }
+
+    return eng::result<eng::texture_streamer>::success(std::move(streamer));
+}
+
+eng::texture_streamer::texture_id eng::texture_streamer::add_texture(eng::texture_streamer::texture_description description) {
+    if (!valid()) {
+        throw std::logic_error("Called add_texture on an invalid texture streamer.");
+    }
+
+    if (description.width == 0 || description.height == 0) {
+        throw std::invalid_argument("Texture size must be greater than zero.");
+    }
+
+    uint32_t full_mip_count = 0;
+
+    for (uint32_t dimension = std::max(description.width, description.height); dimension > 0; dimension >>= 1) {
+        ++full_mip_count;
+    }
+
+    if (description.mip_count == 0 || description.mip_count > full_mip_count) {
+        throw std::invalid_argument("Texture mip count must be between one and the length of its full mip chain.");
+    }
+
+    if (description.block_extent == 0 || description.block_size == 0) {
+        throw std::invalid_argument("Texture block extent and size must be greater than zero.");
+    }
+
+    if (!description.load_mip) {
+        throw std::invalid_argument("Texture has no load_mip callback.");
+    }
+
+    texture entry{};
+    entry.description = std::make_shared<const texture_description>(std::move(description));
+    entry.image = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, streaming_heap };
+    entry.resident_mip = entry.description->mip_count;
+    entry.target_mip = entry.resident_mip;
+    entry.tail_mip = entry.description->mip_count - 1;
+    entry.active = true;
+
+    while (entry.tail_mip > 0 && mip_dimension(*entry.description, entry.tail_mip - 1) <= configuration.tail_size) {
+        --entry.tail_mip;
+    }
+
+    VkDeviceSize alignment = copy_alignment(*entry.description);
+    VkDeviceSize tail_bytes = 0;
+
+    for (uint32_t mip = entry.tail_mip; mip < entry.description->mip_count; ++mip) {
+        tail_bytes = align_up(tail_bytes, alignment) + mip_bytes(*entry.description, mip);
+    }
+
+    if (tail_bytes > staging_region_size) {
+        throw std::invalid_argument("Texture mip tail does not fit in the staging buffer.");
+    }
+
+    entry.min_mip = entry.tail_mip;
+
+    while (entry.min_mip > 0 && mip_bytes(*entry.description, entry.min_mip - 1) <= staging_region_size) {
+        --entry.min_mip;
+    }
+
+    texture_id id;
+
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+
+        entry.generation = textures[id].generation;
+        textures[id] = std::move(entry);
+    }
+    else {
+        id = static_cast<texture_id>(textures.size());
+        textures.push_back(std::move(entry));
+    }
+
+    texture& added = textures[id];
+    added.load_in_flight = true;
+
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->requests.push({ id, added.generation, added.tail_mip, added.description->mip_count - added.tail_mip, std::numeric_limits<float>::max(), added.description });
+    }
+
+    shared->condition.notify_one();
+
+    return id;
+}
+
+void eng::texture_streamer::remove_texture(eng::texture_streamer::texture_id id) {
+    if (id >= textures.size() || !textures[id].active) {
+        throw std::invalid_argument("Invalid texture id.");
+    }
+
+    texture& texture = textures[id];
+    retire(texture);
+
+    // results still in flight for this id are recognised as stale by the generation
+    texture.description.reset();
+    texture.active = false;
+    texture.load_in_flight = false;
+    ++texture.generation;
+
+    free_ids.push_back(id);
+}
+
+void eng::texture_streamer::set_screen_size(eng::texture_streamer::texture_id id, float pixels) {
+    if (id >= textures.size() || !textures[id].active) {
+        throw std::invalid_argument("Invalid texture id.");
+    }
+
+    textures[id].screen_size = std::max(0.0f, pixels);
+}
+
+void eng::texture_streamer::update(const eng::device& device, VkCommandBuffer command_buffer, std::pmr::memory_resource* resource) {
+    if (!valid()) {
+        throw std::logic_error("Called update on an invalid texture streamer.");
+    }
+
+    frame_slot = (frame_slot + 1) % configuration.frames_in_flight;
+
+    for (image_allocation& image : retired_images[frame_slot]) {
+        destroy_image(image);
+    }
+
+    retired_images[frame_slot].clear();
+    staging_offset = 0;
+    changed_textures.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+
+        for (load_result& result : shared->results) {
+            pending_results.push_back(std::move(result));
+        }
+
+        shared->results.clear();
+    }
+
+    // most urgent first, so a full staging buffer defers the least important loads. std::sort doesn't allocate
+    // a merge buffer the way std::stable_sort does, and the id and generation keep the order deterministic on ties
+    std::sort(pending_results.begin(), pending_results.end(), [](const load_result& a, const load_result& b) {
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+
+        if (a.id != b.id) {
+            return a.id < b.id;
+        }
+
+        return a.generation < b.generation;
+    });
+
+    device.query_memory_budget(heap_budgets);
+
+    // memory the streamer owns is excluded from usage, including images waiting to be released
+    const eng::device::heap_budget& heap = heap_budgets[streaming_heap];
+    VkDeviceSize streamer_usage = heap_resident[streaming_heap] + retired_bytes(streaming_heap);
+    VkDeviceSize other_usage = heap.usage > streamer_usage ? heap.usage - streamer_usage : 0;
+    VkDeviceSize cap = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * configuration.budget_fraction);
+    VkDeviceSize limit = cap > other_usage ? cap - other_usage : 0;
+    VkDeviceSize planned = heap_resident[streaming_heap];
+
+    for (texture& texture : textures) {
+        texture.target_mip = texture.resident_mip;
+        texture.staged = false;
+    }
+
+    // results that don't fit in this frame's staging region are compacted to the front and kept for the next update
+    size_t deferred_count = 0;
+
+    for (load_result& result : pending_results) {
+        texture& texture = textures[result.id];
+
+        if (!texture.active || texture.generation != result.generation) {
+            continue;
+        }
+
+        if (!result.succeeded) {
+            texture.load_in_flight = false;
+            texture.min_mip = std::min(result.first_mip + 1, texture.tail_mip);
+            ++failed_loads;
+            continue;
+        }
+
+        bool tail = result.first_mip == texture.tail_mip;
+
+        // an eviction since the request would leave a gap below the loaded mip, and the camera may have moved away
+        if (result.first_mip + result.mip_count != texture.target_mip || (!tail && result.first_mip < desired_mip(texture))) {
+            texture.load_in_flight = false;
+            ++dropped_loads;
+            continue;
+        }
+
+        if (align_up(staging_offset, copy_alignment(*texture.description)) + result.data.size() > staging_region_size) {
+            if (&pending_results[deferred_count] != &result) {
+                pending_results[deferred_count] = std::move(result);
+            }
+
+            ++deferred_count;
+            continue;
+        }
+
+        VkDeviceSize needed = 0;
+
+        for (uint32_t mip = result.first_mip; mip < result.first_mip + result.mip_count; ++mip) {
+            needed += mip_bytes(*texture.description, mip);
+        }
+
+        // marked before evicting so the texture can't pick its own resident mip as the victim,
+        // and weighed at the current screen size rather than the one it was requested at
+        texture.staged = true;
+
+        // the tail is small and required for the texture to be usable at all, so it is never refused
+        if (!tail && !evict(needed, priority(texture, result.first_mip), planned, limit)) {
+            texture.staged = false;
+            texture.load_in_flight = false;
+            ++dropped_loads;
+            continue;
+        }
+
+        texture.load_in_flight = false;
+        texture.target_mip = result.first_mip;
+        planned += needed;
+
+        stage(result);
+    }
+
+    pending_results.resize(deferred_count);
+
+    // the budget can shrink under us when other processes allocate
+    if (planned > limit) {
+        evict(0, std::numeric_limits<float>::max(), planned, limit);
+    }
+
+    float lowest_evictable = std::numeric_limits<float>::max();
+
+    for (const texture& texture : textures) {
+        if (texture.active && !texture.staged && texture.target_mip < texture.tail_mip) {
+            lowest_evictable = std::min(lowest_evictable, priority(texture, texture.target_mip));
+        }
+    }
+
+    std::pmr::vector<load_request> requests(resource);
+
+    for (texture_id id = 0; id < textures.size(); ++id) {
+        texture& texture = textures[id];
+
+        if (!texture.active || texture.load_in_flight || texture.target_mip > texture.tail_mip || texture.target_mip <= desired_mip(texture)) {
+            continue;
+        }
+
+        uint32_t mip = texture.target_mip - 1;
+        float mip_priority = priority(texture, mip);
+
+        // only load what fits, or what could displace something less important
+        if (planned + mip_bytes(*texture.description, mip) > limit && lowest_evictable >= mip_priority) {
+            continue;
+        }
+
+        texture.load_in_flight = true;
+        requests.push_back({ id, texture.generation, mip, 1, mip_priority, texture.description });
+    }
+
+    if (!requests.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+
+            for (load_request& request : requests) {
+                shared->requests.push(std::move(request));
+            }
+        }
+
+        shared->condition.notify_all();
+    }
+
+    apply_residency(device, command_buffer, resource);
+    staged_uploads.clear();
+}
+
+VkImageView eng::texture_streamer::get_image_view(eng::texture_streamer::texture_id id) const {
+    if (id >= textures.size() || !textures[id].active) {
+        throw std::invalid_argument("Invalid texture id.");
+    }
+
+    return textures[id].image.image_view_handle;
+}
+
+uint32_t eng::texture_streamer::get_resident_mip(eng::texture_streamer::texture_id id) const {
+    if (id >= textures.size() || !textures[id].active) {
+        throw std::invalid_argument("Invalid texture id.");
+    }
+
+    return textures[id].resident_mip;
+}
+
+eng::texture_streamer::statistics eng::texture_streamer::get_statistics() const {
+    statistics stats{};
+
+    for (size_t i = 0; i < heap_budgets.size(); ++i) {
+        const eng::device::heap_budget& heap = heap_budgets[i];
+        VkDeviceSize resident = i < heap_resident.size() ? heap_resident[i] : 0;
+
+        stats.heaps.push_back({ heap.size, heap.budget, heap.usage, resident, heap.device_local });
+    }
+
+    for (const texture& texture : textures) {
+        if (!texture.active) {
+            continue;
+        }
+
+        ++stats.texture_count;
+
+        if (texture.resident_mip <= desired_mip(texture)) {
+            ++stats.textures_complete;
+        }
+
+        if (texture.load_in_flight) {
+            ++stats.pending_loads;
+        }
+    }
+
+    stats.uploaded_bytes = uploaded_bytes;
+    stats.uploaded_mips = uploaded_mips;
+    stats.evicted_mips = evicted_mips;
+    stats.dropped_loads = dropped_loads;
+    stats.failed_loads = failed_loads;
+
+    return stats;
+}
+
+eng::texture_streamer::texture_streamer()
+    : logical_device_handle(VK_NULL_HANDLE),
+    memory_properties(),
+    streaming_heap(0),
+    configuration(),
+    staging_buffer(),
+    staging_region_size(0),
+    staging_offset(0),
+    frame_slot(0),
+    shared(),
+    uploaded_bytes(0),
+    uploaded_mips(0),
+    evicted_mips(0),
+    dropped_loads(0),
+    failed_loads(0) {}
+
+eng::texture_streamer::~texture_streamer() {
+    destroy();
+}
+
+eng::texture_streamer::texture_streamer(eng::texture_streamer&& other) noexcept
+    : logical_device_handle(std::exchange(other.logical_device_handle, VK_NULL_HANDLE)),
+    memory_properties(other.memory_properties),
+    streaming_heap(other.streaming_heap),
+    configuration(other.configuration),
+    staging_buffer(std::move(other.staging_buffer)),
+    staging_region_size(other.staging_region_size),
+    staging_offset(other.staging_offset),
+    frame_slot(other.frame_slot),
+    shared(std::move(other.shared)),
+    textures(std::move(other.textures)),
+    free_ids(std::move(other.free_ids)),
+    pending_results(std::move(other.pending_results)),
+    staged_uploads(std::move(other.staged_uploads)),
+    retired_images(std::move(other.retired_images)),
+    changed_textures(std::move(other.changed_textures)),
+    heap_budgets(std::move(other.heap_budgets)),
+    heap_resident(std::move(other.heap_resident)),
+    uploaded_bytes(other.uploaded_bytes),
+    uploaded_mips(other.uploaded_mips),
+    evicted_mips(other.evicted_mips),
+    dropped_loads(other.dropped_loads),
+    failed_loads(other.failed_loads) {}
+
+eng::texture_streamer& eng::texture_streamer::operator=(eng::texture_streamer&& other) noexcept {
+    if (this != &other) {
+        destroy();
+
+        logical_device_handle = std::exchange(other.logical_device_handle, VK_NULL_HANDLE);
+        memory_properties = other.memory_properties;
+        streaming_heap = other.streaming_heap;
+        configuration = other.configuration;
+        staging_buffer = std::move(other.staging_buffer);
+        staging_region_size = other.staging_region_size;
+        staging_offset = other.staging_offset;
+        frame_slot = other.frame_slot;
+        shared = std::move(other.shared);
+        textures = std::move(other.textures);
+        free_ids = std::move(other.free_ids);
+        pending_results = std::move(other.pending_results);
+        staged_uploads = std::move(other.staged_uploads);
+        retired_images = std::move(other.retired_images);
+        changed_textures = std::move(other.changed_textures);
+        heap_budgets = std::move(other.heap_budgets);
+        heap_resident = std::move(other.heap_resident);
+        uploaded_bytes = other.uploaded_bytes;
+        uploaded_mips = other.uploaded_mips;
+        evicted_mips = other.evicted_mips;
+        dropped_loads = other.dropped_loads;
+        failed_loads = other.failed_loads;
+    }
+
+    return *this;
+}
+
+void eng::texture_streamer::worker_main(eng::texture_streamer::shared_state* state) {
+    std::vector<uint8_t> mip_data;
+
+    while (true) {
+        load_request request;
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->condition.wait(lock, [state] { return state->stopping || !state->requests.empty(); });
+
+            if (state->stopping) {
+                return;
+            }
+
+            request = state->requests.top();
+            state->requests.pop();
+        }
+
+        const texture_description& description = *request.description;
+        VkDeviceSize alignment = copy_alignment(description);
+
+        load_result result{};
+        result.id = request.id;
+        result.generation = request.generation;
+        result.first_mip = request.first_mip;
+        result.mip_count = request.mip_count;
+        result.priority = request.priority;
+        result.succeeded = true;
+
+        for (uint32_t mip = request.first_mip; mip < request.first_mip + request.mip_count; ++mip) {
+            mip_data.clear();
+
+            if (!description.load_mip(mip, mip_data) || mip_data.size() != mip_bytes(description, mip)) {
+                result.succeeded = false;
+                break;
+            }
+
+            VkDeviceSize offset = align_up(result.data.size(), alignment);
+            result.mip_offsets.push_back(offset);
+            result.data.resize(offset);
+            result.data.insert(result.data.end(), mip_data.begin(), mip_data.end());
+        }
+
+        if (!result.succeeded) {
+            result.mip_offsets.clear();
+            result.data.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->results.push_back(std::move(result));
+    }
+}
+
+VkDeviceSize eng::texture_streamer::mip_bytes(const eng::texture_streamer::texture_description& description, uint32_t mip) {
+    VkExtent3D extent = mip_extent(description, mip);
+    VkDeviceSize blocks_x = (extent.width + description.block_extent - 1) / description.block_extent;
+    VkDeviceSize blocks_y = (extent.height + description.block_extent - 1) / description.block_extent;
+
+    return blocks_x * blocks_y * description.block_size;
+}
+
+VkDeviceSize eng::texture_streamer::copy_alignment(const eng::texture_streamer::texture_description& description) {
+    // buffer offsets of copies must be a multiple of both 4 and the block size
+    return std::lcm<VkDeviceSize>(4, description.block_size);
+}
+
+uint32_t eng::texture_streamer::mip_dimension(const eng::texture_streamer::texture_description& description, uint32_t mip) {
+    return std::max(1u, std::max(description.width, description.height) >> mip);
+}
+
+VkExtent3D eng::texture_streamer::mip_extent(const eng::texture_streamer::texture_description& description, uint32_t mip) {
+    return { std::max(1u, description.width >> mip), std::max(1u, description.height >> mip), 1 };
+}
+
+float eng::texture_streamer::priority(const eng::texture_streamer::texture& texture, uint32_t mip) const {
+    // how many screen pixels each texel of the mip would cover, above one the mip is needed for full detail
+    return texture.screen_size / static_cast<float>(mip_dimension(*texture.description, mip));
+}
+
+uint32_t eng::texture_streamer::desired_mip(const eng::texture_streamer::texture& texture) const {
+    if (texture.screen_size <= 0.0f) {
+        return texture.tail_mip;
+    }
+
+    float ratio = static_cast<float>(mip_dimension(*texture.description, 0)) / texture.screen_size;
+    uint32_t mip = ratio > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(ratio))) : 0;
+
+    return std::clamp(mip, std::min(texture.min_mip, texture.tail_mip), texture.tail_mip);
+}
+
+VkDeviceSize eng::texture_streamer::retired_bytes(uint32_t heap_index) const {
+    VkDeviceSize bytes = 0;
+
+    for (const std::vector<image_allocation>& images : retired_images) {
+        for (const image_allocation& image : images) {
+            if (image.heap_index == heap_index) {
+                bytes += image.memory_size;
+            }
+        }
+    }
+
+    return bytes;
+}
+
+bool eng::texture_streamer::evict(VkDeviceSize needed, float below_priority, VkDeviceSize& planned, VkDeviceSize limit) {
+    while (planned + needed > limit) {
+        texture* victim = nullptr;
+        float victim_priority = below_priority;
+
+        // the finest mip of whichever texture needs it least, textures with uploads this frame are left alone
+        for (texture& candidate : textures) {
+            if (!candidate.active || candidate.staged || candidate.target_mip >= candidate.tail_mip) {
+                continue;
+            }
+
+            float candidate_priority = priority(candidate, candidate.target_mip);
+
+            if (candidate_priority < victim_priority) {
+                victim = &candidate;
+                victim_priority = candidate_priority;
+            }
+        }
+
+        if (victim == nullptr) {
+            return false;
+        }
+
+        planned -= std::min(planned, mip_bytes(*victim->description, victim->target_mip));
+        ++victim->target_mip;
+    }
+
+    return true;
+}
+
+void eng::texture_streamer::stage(eng::texture_streamer::load_result& result) {
+    VkDeviceSize offset = align_up(staging_offset, copy_alignment(*textures[result.id].description));
+    VkDeviceSize base = static_cast<VkDeviceSize>(frame_slot) * staging_region_size + offset;
+
+    staging_buffer.write(result.data.data(), result.data.size(), base);
+    staging_offset = offset + result.data.size();
+    uploaded_bytes += result.data.size();
+
+    staged_uploads.push_back({ result.id, result.first_mip, result.mip_count, base, std::move(result.mip_offsets) });
+}
+
+void eng::texture_streamer::apply_residency(const eng::device& device, VkCommandBuffer command_buffer, std::pmr::memory_resource* resource) {
+    struct replacement {
+        texture_id id;
+        image_allocation image;
+        const staged_upload* upload;
+    };
+
+    std::pmr::vector<replacement> replacements(resource);
+    std::pmr::vector<VkImageMemoryBarrier> barriers(resource);
+
+    for (texture_id id = 0; id < textures.size(); ++id) {
+        texture& texture = textures[id];
+
+        if (!texture.active || texture.target_mip == texture.resident_mip) {
+            continue;
+        }
+
+        eng::result<image_allocation> image_result = create_image(device, *texture.description, texture.target_mip);
+
+        if (image_result.is_error()) {
+            texture.target_mip = texture.resident_mip;
+            ++failed_loads;
+            continue;
+        }
+
+        replacement change{ id, image_result.unwrap(), nullptr };
+
+        for (const staged_upload& upload : staged_uploads) {
+            if (upload.id == id) {
+                change.upload = &upload;
+            }
+        }
+
+        uint32_t mip_count = texture.description->mip_count;
+
+        barriers.push_back(image_barrier(change.image.image_handle, mip_count - texture.target_mip,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+
+        if (texture.image.image_handle != VK_NULL_HANDLE) {
+            barriers.push_back(image_barrier(texture.image.image_handle, mip_count - texture.resident_mip,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+        }
+
+        replacements.push_back(change);
+    }
+
+    if (replacements.empty()) {
+        return;
+    }
+
+    vkCmdPipelineBarrier(command_buffer, sampling_stages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    std::pmr::vector<VkImageCopy> image_copies(resource);
+    std::pmr::vector<VkBufferImageCopy> buffer_copies(resource);
+    barriers.clear();
+
+    uint32_t copy_commands = 0;
+
+    for (const replacement& change : replacements) {
+        const texture& texture = textures[change.id];
+        const texture_description& description = *texture.description;
+
+        // mips kept from the old image move down or up by the number of levels gained or lost
+        if (texture.image.image_handle != VK_NULL_HANDLE) {
+            image_copies.clear();
+
+            for (uint32_t mip = std::max(texture.target_mip, texture.resident_mip); mip < description.mip_count; ++mip) {
+                VkImageCopy copy{};
+                copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - texture.resident_mip, 0, 1 };
+                copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - texture.target_mip, 0, 1 };
+                copy.extent = mip_extent(description, mip);
+                image_copies.push_back(copy);
+            }
+
+            vkCmdCopyImage(command_buffer, texture.image.image_handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                change.image.image_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(image_copies.size()), image_copies.data());
+            ++copy_commands;
+        }
+
+        if (change.upload != nullptr) {
+            buffer_copies.clear();
+
+            for (uint32_t i = 0; i < change.upload->mip_count; ++i) {
+                uint32_t mip = change.upload->first_mip + i;
+
+                VkBufferImageCopy copy{};
+                copy.bufferOffset = change.upload->staging_offset + change.upload->mip_offsets[i];
+                copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - texture.target_mip, 0, 1 };
+                copy.imageExtent = mip_extent(description, mip);
+                buffer_copies.push_back(copy);
+            }
+
+            vkCmdCopyBufferToImage(command_buffer, staging_buffer.get_vulkan_buffer(), change.image.image_handle,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(buffer_copies.size()), buffer_copies.data());
+            ++copy_commands;
+
+            uploaded_mips += change.upload->mip_count;
+        }
+
+        barriers.push_back(image_barrier(change.image.image_handle, description.mip_count - texture.target_mip,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+
+        // the retired image can still be sampled through descriptors that haven't been rewritten yet
+        if (texture.image.image_handle != VK_NULL_HANDLE) {
+            barriers.push_back(image_barrier(texture.image.image_handle, description.mip_count - texture.resident_mip,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT));
+        }
+    }
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, sampling_stages, 0,
+        0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::copy_to_image, copy_commands);
+    eng::capture::record_unreplayable(command_buffer, eng::capture::unreplayable_kind::image_barrier, 2);
+
+    for (const replacement& change : replacements) {
+        texture& texture = textures[change.id];
+
+        if (texture.target_mip > texture.resident_mip && texture.resident_mip < texture.description->mip_count) {
+            evicted_mips += texture.target_mip - texture.resident_mip;
+        }
+
+        retire(texture);
+
+        texture.image = change.image;
+        texture.resident_mip = texture.target_mip;
+        heap_resident[texture.image.heap_index] += texture.image.memory_size;
+
+        changed_textures.push_back(change.id);
+    }
+}
+
+eng::result<eng::texture_streamer::image_allocation> eng::texture_streamer::create_image(const eng::device& device, const eng::texture_streamer::texture_description& description, uint32_t first_mip) const {
+    image_allocation image{ VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, streaming_heap };
+    uint32_t level_count = description.mip_count - first_mip;
+
+    VkImageCreateInfo image_create_info{};
+    image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType = VK_IMAGE_TYPE_2D;
+    image_create_info.format = description.format;
+    image_create_info.extent = mip_extent(description, first_mip);
+    image_create_info.mipLevels = level_count;
+    image_create_info.arrayLayers = 1;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(logical_device_handle, &image_create_info, nullptr, &image.image_handle) != VK_SUCCESS) {
+        return eng::result<image_allocation>::error("Failed to create streamed texture image.");
+    }
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(logical_device_handle, image.image_handle, &memory_requirements);
+
+    eng::result<uint32_t> memory_type_result = device.find_memory_type(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memory_type_result.is_error()) {
+        destroy_image(image);
+        return eng::result<image_allocation>::error(memory_type_result.error_message());
+    }
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = memory_requirements.size;
+    allocate_info.memoryTypeIndex = memory_type_result.unwrap();
+
+    if (vkAllocateMemory(logical_device_handle, &allocate_info, nullptr, &image.memory_handle) != VK_SUCCESS) {
+        destroy_image(image);
+        return eng::result<image_allocation>::error("Failed to allocate streamed texture memory.");
+    }
+
+    image.memory_size = memory_requirements.size;
+    image.heap_index = memory_properties.memoryTypes[allocate_info.memoryTypeIndex].heapIndex;
+
+    vkBindImageMemory(logical_device_handle, image.image_handle, image.memory_handle, 0);
+
+    VkImageViewCreateInfo view_create_info{};
+    view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_create_info.image = image.image_handle;
+    view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format = description.format;
+    view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_create_info.subresourceRange.baseMipLevel = 0;
+    view_create_info.subresourceRange.levelCount = level_count;
+    view_create_info.subresourceRange.baseArrayLayer = 0;
+    view_create_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(logical_device_handle, &view_create_info, nullptr, &image.image_view_handle) != VK_SUCCESS) {
+        destroy_image(image);
+        return eng::result<image_allocation>::error("Failed to create streamed texture image view.");
+    }
+
+    return eng::result<image_allocation>::success(image);
+}
+
+void eng::texture_streamer::retire(eng::texture_streamer::texture& texture) {
+    if (texture.image.image_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    heap_resident[texture.image.heap_index] -= texture.image.memory_size;
+    retired_images[frame_slot].push_back(texture.image);
+
+    texture.image = { VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, streaming_heap };
+}
+
+void eng::texture_streamer::destroy_image(eng::texture_streamer::image_allocation& image) const {
+    if (image.image_view_handle != VK_NULL_HANDLE) {
+        vkDestroyImageView(logical_device_handle, image.image_view_handle, nullptr);
+        image.image_view_handle = VK_NULL_HANDLE;
+    }
+
+    if (image.image_handle != VK_NULL_HANDLE) {
+        vkDestroyImage(logical_device_handle, image.image_handle, nullptr);
+        image.image_handle = VK_NULL_HANDLE;
+    }
+
+    if (image.memory_handle != VK_NULL_HANDLE) {
+        vkFreeMemory(logical_device_handle, image.memory_handle, nullptr);
+        image.memory_handle = VK_NULL_HANDLE;
+    }
+}
+
+void eng::texture_streamer::destroy() {
+    if (shared != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->stopping = true;
+        }
+
+        shared->condition.notify_all();
+
+        for (std::thread& worker : shared->workers) {
+            worker.join();
+        }
+
+        shared.reset();
+    }
+
+    if (logical_device_handle == VK_NULL_HANDLE) {
+        return;
+    }
+
+    for (texture& texture : textures) {
+        destroy_image(texture.image);
+    }
+
+    for (std::vector<image_allocation>& images : retired_images) {
+        for (image_allocation& image : images) {
+            destroy_image(image);
+        }
+    }
+
+    textures.clear();
+    free_ids.clear();
+    pending_results.clear();
+    staged_uploads.clear();
+    retired_images.clear();
+    changed_textures.clear();
+
+    logical_device_handle = VK_NULL_HANDLE;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "device.hpp"
+#include "instance.hpp"
+#include "replayer.hpp"
+
+// replays a capture on a headless device and prints per frame cpu and gpu times.
+// usage: replay <capture> [--paced] [--repeat count] [--quiet]
+// the highest scoring device is used, VK_ICD_FILENAMES can restrict the loader to a software driver like lavapipe
+namespace {
+    struct summary {
+        double average;
+        double minimum;
+        double maximum;
+        double percentile_95;
+    };
+
+    summary summarize(std::vector<double> values) {
+        summary result{};
+
+        if (values.empty()) {
+            return result;
+        }
+
+        std::sort(values.begin(), values.end());
+
+        double total = 0.0;
+
+        for (double value : values) {
+            total += value;
+        }
+
+        result.average = total / values.size();
+        result.minimum = values.front();
+        result.maximum = values.back();
+        result.percentile_95 = values[std::min(values.size() - 1, values.size() * 95 / 100)];
+
+        return result;
+    }
+
+    void print_summary(const char* name, const summary& values) {
+        std::printf("%s  avg %8.3f ms  min %8.3f ms  p95 %8.3f ms  max %8.3f ms\n",
+            name, values.average, values.minimum, values.percentile_95, values.maximum);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    eng::replayer::pacing pacing = eng::replayer::pacing::unlimited;
+    uint32_t repeat = 1;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--paced") == 0) {
+            pacing = eng::replayer::pacing::recorded;
+        }
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<uint32_t>(std::max(1ul, std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+        else if (path == nullptr) {
+            path = argv[i];
+        }
+        else {
+            path = nullptr;
+            break;
+        }
+    }
+
+    if (path == nullptr) {
+        std::fprintf(stderr, "usage: replay <capture> [--paced] [--repeat count] [--quiet]\n");
+        return 1;
+    }
+
+    eng::result<eng::instance> instance_result = eng::instance::create_instance("replay", nullptr);
+
+    if (instance_result.is_error()) {
+        std::fprintf(stderr, "%s\n", instance_result.error_message());
+        return 1;
+    }
+
+    eng::instance instance = std::move(instance_result.unwrap());
+
+    eng::result<eng::device> device_result = eng::device::create_device(instance, nullptr);
+
+    if (device_result.is_error()) {
+        std::fprintf(stderr, "%s\n", device_result.error_message());
+        return 1;
+    }
+
+    eng::device device = std::move(device_result.unwrap());
+
+    eng::result<eng::replayer> replayer_result = eng::replayer::create_replayer(device, path);
+
+    if (replayer_result.is_error()) {
+        std::fprintf(stderr, "%s\n", replayer_result.error_message());
+        return 1;
+    }
+
+    eng::replayer replayer = std::move(replayer_result.unwrap());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.get_vulkan_physical_device(), &properties);
+
+    std::printf("captured on %s, replaying on %s, %u frames\n",
+        replayer.get_captured_device_name().c_str(), properties.deviceName, replayer.get_frame_count());
+
+    std::vector<double> cpu_times;
+    std::vector<double> gpu_times;
+
+    for (uint32_t run = 0; run < repeat; ++run) {
+        eng::result<std::vector<eng::replayer::frame_timing>> run_result = replayer.run(device, pacing);
+
+        if (run_result.is_error()) {
+            std::fprintf(stderr, "%s\n", run_result.error_message());
+            return 1;
+        }
+
+        const std::vector<eng::replayer::frame_timing>& timings = run_result.unwrap();
+
+        for (size_t frame = 0; frame < timings.size(); ++frame) {
+            const eng::replayer::frame_timing& timing = timings[frame];
+
+            if (!quiet) {
+                std::printf("run %u frame %zu  commands %u  cpu %8.3f ms  gpu %8.3f ms  recorded %8.3f ms\n",
+                    run, frame, timing.commands, timing.cpu_milliseconds, timing.gpu_milliseconds, timing.recorded_milliseconds);
+            }
+
+            cpu_times.push_back(timing.cpu_milliseconds);
+            gpu_times.push_back(timing.gpu_milliseconds);
+        }
+    }
+
+    print_summary("cpu", summarize(cpu_times));
+
+    if (replayer.has_gpu_timing()) {
+        print_summary("gpu", summarize(gpu_times));
+    }
+    else {
+        std::printf("gpu  timestamps unavailable on this queue\n");
+    }
+
+    if (replayer.get_skipped_commands() > 0) {
+        std::printf("%llu commands skipped, they used objects created before the capture started or image descriptors\n",
+            static_cast<unsigned long long>(replayer.get_skipped_commands()));
+    }
+
+    const char* unreplayable_names[eng::capture::unreplayable_kind_count] = {
+        "draws", "indirect draws", "indirect count draws", "copies to images", "image barriers"
+    };
+
+    for (uint32_t kind = 0; kind < eng::capture::unreplayable_kind_count; ++kind) {
+        uint64_t count = replayer.get_unreplayable_commands(static_cast<eng::capture::unreplayable_kind>(kind));
+
+        if (count > 0) {
+            std::printf("%llu %s not replayed, the times above leave them out\n", static_cast<unsigned long long>(count), unreplayable_names[kind]);
+        }
+    }
+
+    return 0;
+}